@@ -0,0 +1,44 @@
+//
+//  bench_deque.cpp
+//  HW6
+//
+//  stable_vector used as a deque: 1e6 alternating front/back operations,
+//  compared against std::deque.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+
+#include "stable_vector.hpp"
+
+template<typename Container>
+double run(const int n) {
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    Container c;
+    long sum = 0;
+    for (int i = 0; i < n; ++i) {       // push_front / push_back
+        if (i & 1) c.push_back(i);
+        else c.push_front(i);
+    }
+    for (int i = 0; i < n; ++i) {       // queue in both directions
+        if (i & 1) { c.push_back(i); sum += c.front(); c.pop_front(); }
+        else { c.push_front(i); sum += c.back(); c.pop_back(); }
+    }
+    for (int i = 0; i < n; ++i) {       // pop_front / pop_back
+        if (i & 1) c.pop_back();
+        else c.pop_front();
+    }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    if (!c.empty() || sum == 42) std::cerr << "unexpected" << std::endl;
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+int main(int argc, char* argv[]) {
+    const int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    std::cout << "ops per phase: " << n << std::endl;
+    std::cout << "std::deque     " << run<std::deque<int> >(n) << " ms" << std::endl;
+    std::cout << "stable_vector  " << run<stable_vector<int> >(n) << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,77 @@
+//
+//  bench_false_sharing.cpp
+//  HW6
+//
+//  Threads updating different elements of one container at the same time.
+//  Element i belongs to thread i % threads, so neighbouring elements are
+//  written by different threads; each thread takes references to its
+//  elements once (they are stable) and then increments each of them
+//  `rounds` times. With std::vector<long> eight elements share a cache
+//  line, with stable_vector<long> the 16-byte nodes of one slab sit four to
+//  a line, and with NodeAlign = cache_line_align every node has a line of
+//  its own, so the lines stop bouncing between cores. The reported time is
+//  per update; on a single core all layouts should be about the same.
+//
+//  Usage: bench_false_sharing [threads] [elements] [rounds]
+//         (default max(2, hardware_concurrency), 64 per thread, 200000)
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stable_vector.hpp"
+
+typedef std::chrono::steady_clock bench_clock;
+
+template<typename Container>
+void run(const std::string& name, const unsigned threads, const long elements, const long rounds) {
+    Container c(static_cast<std::size_t>(elements), 0L);
+    std::atomic<unsigned> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&, t]() {
+            std::vector<long*> mine;
+            for (long i = t; i < elements; i += threads) mine.push_back(&c[i]);
+            ++ready;
+            while (!go) std::this_thread::yield();
+            for (long r = 0; r < rounds; ++r)
+                for (std::size_t k = 0; k < mine.size(); ++k) {
+                    volatile long& x = *mine[k];   //每次都真的寫回記憶體
+                    x = x + 1;
+                }
+        }));
+    }
+    while (ready != threads) std::this_thread::yield();
+    bench_clock::time_point t0 = bench_clock::now();
+    go = true;
+    for (unsigned t = 0; t < threads; ++t) workers[t].join();
+    double ns = std::chrono::duration<double, std::nano>(bench_clock::now() - t0).count();
+
+    bool ok = std::count(c.begin(), c.end(), rounds) == elements;
+    std::cout << std::left << std::setw(36) << name << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+              << ns / 1e6 << std::setw(12) << std::setprecision(2) << ns * threads / (static_cast<double>(elements) * rounds)
+              << (ok ? "" : "  (wrong sums)") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const unsigned hw = std::thread::hardware_concurrency();
+    const unsigned threads = argc > 1 ? static_cast<unsigned>(std::atol(argv[1])) : std::max(2u, hw);
+    const long elements = argc > 2 ? std::atol(argv[2]) : 64L * threads;
+    const long rounds = argc > 3 ? std::atol(argv[3]) : 200000;
+
+    std::cout << threads << " threads (" << hw << " hardware), " << elements << " elements, "
+              << rounds << " rounds (ms, ns per update per thread)" << std::endl;
+    std::cout << std::left << std::setw(36) << "container" << std::right << std::setw(12) << "ms" << std::setw(12) << "ns/update" << std::endl;
+    run<std::vector<long> >("std::vector<long>", threads, elements, rounds);
+    run<stable_vector<long> >("stable_vector<long>", threads, elements, rounds);
+    run<stable_vector<long, std::allocator<long>, 0, cache_line_align> >("stable_vector<long, node align 64>", threads, elements, rounds);
+    return 0;
+}
@@ -0,0 +1,59 @@
+//
+//  bench_fixup.cpp
+//  HW6
+//
+//  Time of a full up-pointer fix-up in stable_vector against the number of
+//  threads it may use (stable_vector_parallel::threads). Each round inserts
+//  and then erases at position 1 of an n-element container, so each of the
+//  two operations moves the index by one slot and rewrites the up pointer of
+//  every later node; the reported time is per operation. Thread counts go
+//  1, 2, 4, ... up to max_threads, plus max_threads itself.
+//
+//  Usage: bench_fixup [n] [max_threads] [rounds]
+//         (default 20000000, hardware_concurrency, 5)
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "stable_vector.hpp"
+
+typedef std::chrono::steady_clock bench_clock;
+
+int main(int argc, char* argv[]) {
+    const long n = argc > 1 ? std::atol(argv[1]) : 20000000;
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned max_threads = argc > 2 ? static_cast<unsigned>(std::atol(argv[2])) : hw;
+    const int rounds = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < max_threads; t *= 2) counts.push_back(t);
+    counts.push_back(max_threads);
+
+    stable_vector<long> c(static_cast<std::size_t>(n), 0L);
+    stable_vector_parallel::fixup_threshold() = 0;     //每次都走平行的路徑, 1 thread 就是原本的迴圈
+
+    std::cout << "n = " << n << ", rounds = " << rounds << ", hardware threads = " << hw << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "ms/fixup" << std::setw(10) << "speedup" << std::endl;
+    double base = 0;
+    for (std::size_t k = 0; k < counts.size(); ++k) {
+        stable_vector_parallel::threads() = counts[k];
+        c.insert(c.cbegin() + 1, 1L);   //暖身: 讓 index 的容量夠用
+        c.erase(c.cbegin() + 1);
+        bench_clock::time_point t0 = bench_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            c.insert(c.cbegin() + 1, 1L);
+            c.erase(c.cbegin() + 1);
+        }
+        double ms = std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count() / (2 * rounds);
+        if (k == 0) base = ms;
+        std::cout << std::setw(8) << counts[k] << std::setw(14) << std::fixed << std::setprecision(2) << ms
+                  << std::setw(10) << base / ms << std::endl;
+    }
+    return 0;
+}
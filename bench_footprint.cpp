@@ -0,0 +1,90 @@
+//
+//  bench_footprint.cpp
+//  HW6
+//
+//  Heap footprint of many small containers: `containers` stable_vector<int>s
+//  of `elements` each (default 100000 x 10), with the per-container slab
+//  pool (std::allocator), with shared_node_allocator, whose nodes come from
+//  a process-wide cache shared by all containers, and with 16 inline index
+//  slots, which keep a small container's index inside the object. Each
+//  variant is built, then churned (every container erases half its elements
+//  and pushes them back), and the bytes the heap has handed out are reported
+//  after each phase, in total and per container; the array holding the
+//  containers is included, so an empty container shows its sizeof.
+//  std::vector<int> is shown for reference. Heap usage is read with
+//  mallinfo2, so it needs glibc 2.33 or later; elsewhere the bytes are
+//  written as NA.
+//
+//  Usage: bench_footprint [containers] [elements]
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAVE_MALLINFO2 1
+#endif
+
+#include "shared_node_cache.hpp"
+#include "stable_vector.hpp"
+
+typedef std::chrono::steady_clock bench_clock;
+
+static long heap_in_use() {
+#if defined(HAVE_MALLINFO2)
+    struct mallinfo2 m = mallinfo2();
+    return static_cast<long>(m.uordblks + m.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+static void report(const std::string& name, const char* phase, const long bytes, const long containers, const double ms) {
+    std::cout << std::left << std::setw(38) << name << std::setw(8) << phase << std::right;
+    if (bytes < 0) std::cout << std::setw(14) << "NA" << std::setw(12) << "NA";
+    else std::cout << std::setw(14) << bytes << std::setw(12) << std::fixed << std::setprecision(1)
+                   << static_cast<double>(bytes) / containers;
+    std::cout << std::setw(10) << std::fixed << std::setprecision(1) << ms << std::endl;
+}
+
+template<typename Container>
+void run(const std::string& name, const long containers, const long elements) {
+    const long before = heap_in_use();
+    bench_clock::time_point t0 = bench_clock::now();
+    std::vector<Container>* cs = new std::vector<Container>(containers);
+    for (long k = 0; k < containers; ++k)
+        for (long i = 0; i < elements; ++i) (*cs)[k].push_back(static_cast<int>(i));
+    double ms = std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+    report(name, "build", before < 0 ? -1 : heap_in_use() - before, containers, ms);
+
+    t0 = bench_clock::now();
+    for (long k = 0; k < containers; ++k) {
+        Container& c = (*cs)[k];
+        for (long i = 0; i < elements / 2; ++i) c.erase(c.begin() + (k + i) % c.size());
+        for (long i = 0; i < elements / 2; ++i) c.push_back(static_cast<int>(i));
+    }
+    ms = std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+    report(name, "churn", before < 0 ? -1 : heap_in_use() - before, containers, ms);
+    delete cs;
+}
+
+int main(int argc, char* argv[]) {
+    const long containers = argc > 1 ? std::atol(argv[1]) : 100000;
+    const long elements = argc > 2 ? std::atol(argv[2]) : 10;
+    std::cout << containers << " containers x " << elements << " ints (heap bytes, bytes per container, ms)" << std::endl;
+    std::cout << std::left << std::setw(38) << "container" << std::setw(8) << "phase" << std::right
+              << std::setw(14) << "bytes" << std::setw(12) << "per cont." << std::setw(10) << "ms" << std::endl;
+    run<std::vector<int> >("std::vector<int>", containers, elements);
+    run<stable_vector<int> >("stable_vector<int>", containers, elements);
+    run<stable_vector<int, shared_node_allocator<int> > >("stable_vector<int, shared_node>", containers, elements);
+    run<stable_vector<int, std::allocator<int>, 16> >("stable_vector<int, 16 inline slots>", containers, elements);
+    shared_node_cache::stats s = shared_node_cache::statistics();
+    std::cout << "shared_node_cache: " << s.reserved_bytes << " bytes reserved, "
+              << s.depot_blocks << " blocks in the depot" << std::endl;
+    return 0;
+}
@@ -0,0 +1,56 @@
+//
+//  bench_growth.cpp
+//  HW6
+//
+//  push_back growth from empty to n elements (default 1e8): throughput and
+//  per-operation latency percentiles, with absolute back-pointers
+//  (stable_vector), slot-number back-pointers (slot_stable_vector) and
+//  slot numbers plus incremental index growth.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "latency_histogram.hpp"
+#include "stable_vector.hpp"
+#include "slot_stable_vector.hpp"
+
+typedef std::chrono::steady_clock bench_clock;
+
+template<typename Container>
+void run(const char* name, Container& c, const long n) {
+    latency_histogram h;
+    bench_clock::time_point t0 = bench_clock::now(), prev = t0;
+    for (long i = 0; i < n; ++i) {
+        c.push_back(static_cast<int>(i));
+        bench_clock::time_point now = bench_clock::now();
+        h.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - prev).count());
+        prev = now;
+    }
+    double ms = std::chrono::duration<double, std::milli>(prev - t0).count();
+    std::cout << name << "  " << ms << " ms  " << n / ms / 1000 << " Mops/s"
+              << "  p50 " << h.percentile(50) << " ns"
+              << "  p99 " << h.percentile(99) << " ns"
+              << "  p99.9 " << h.percentile(99.9) << " ns"
+              << "  max " << h.max() / 1000.0 << " us" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const long n = argc > 1 ? std::atol(argv[1]) : 100000000;
+    std::cout << "push_back x " << n << std::endl;
+    {
+        stable_vector<int> c;
+        run("stable_vector                 ", c, n);
+    }
+    {
+        slot_stable_vector<int> c;
+        run("slot_stable_vector            ", c, n);
+    }
+    {
+        slot_stable_vector<int> c;
+        c.incremental_growth(true);
+        run("slot_stable_vector incremental", c, n);
+    }
+    return 0;
+}
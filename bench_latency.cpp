@@ -0,0 +1,294 @@
+//
+//  bench_latency.cpp
+//  HW6
+//
+//  Per-operation latency of push_back, insert and erase at a position,
+//  operator[] and a short iterator walk. Every operation is timed on its own
+//  and recorded in a latency_histogram; the percentiles are written as CSV.
+//
+//  Each operation is then run again on its own, on a fresh container of
+//  --size elements and as many times as it ran in the mix, with hardware
+//  counters (perf_counters.hpp) enabled around the whole run. The CSV gets
+//  the per-operation averages of cycles, instructions, L1D/LLC/dTLB read
+//  misses and branch misses; a counter the machine cannot provide is
+//  written as NA.
+//
+//  Every container allocates through counting_allocator, so each row also
+//  has the allocations, frees and bytes requested per operation in the mix
+//  (0 means the operation never touched the allocator), and a summary with
+//  the high-water mark and size classes goes to stderr.
+//
+//  The implementation under test is chosen at compile time:
+//      g++ -O2 -DSV_IMPL=0 bench_latency.cpp    stable_vector.hpp
+//      g++ -O2 -DSV_IMPL=1 bench_latency.cpp    stable_vector1.hpp
+//      g++ -O2 -DSV_IMPL=2 bench_latency.cpp    stable_vector2.hpp
+//  The last two need the Boost headers (checked with Boost 1.74).
+//  Add -DBENCH_RDTSC to time with the TSC instead of steady_clock (x86).
+//
+//  Options (all optional):
+//      --size N      elements before the timed run (default 100000)
+//      --ops N       timed operations (default 1000000)
+//      --mix a,b,c,d,e
+//                    relative weights of push_back, insert, erase,
+//                    operator[] and walk (default 20,20,20,30,10)
+//      --dist D      position distribution for insert/erase/operator[]/walk:
+//                    uniform, front, back or hot (default uniform)
+//      --walk N      elements visited by one walk (default 64)
+//      --seed N      random seed (default 1)
+//      --csv FILE    write CSV to FILE instead of stdout
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(BENCH_RDTSC)
+#include <x86intrin.h>
+#endif
+
+#include "counting_allocator.hpp"
+#include "latency_histogram.hpp"
+#include "perf_counters.hpp"
+
+#ifndef SV_IMPL
+#define SV_IMPL 0
+#endif
+
+#if SV_IMPL == 1
+#include "stable_vector1.hpp"
+typedef stable_vector<long, counting_allocator<long> > container;
+static const char* const impl_name = "stable_vector1.hpp";
+#elif SV_IMPL == 2
+#include "stable_vector2.hpp"
+typedef boost::container::stable_vector<long, counting_allocator<long> > container;
+static const char* const impl_name = "stable_vector2.hpp";
+#else
+#include "stable_vector.hpp"
+typedef stable_vector<long, counting_allocator<long> > container;
+static const char* const impl_name = "stable_vector.hpp";
+#endif
+
+enum op_kind { op_push_back, op_insert, op_erase, op_index, op_walk, op_count };
+static const char* const op_names[op_count] = { "push_back", "insert", "erase", "operator[]", "walk" };
+
+struct options {
+    long size, ops, walk, seed;
+    double mix[op_count];
+    std::string dist, csv;
+};
+
+class bench_timer {
+    public:
+        bench_timer() {
+#if defined(BENCH_RDTSC)
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            std::uint64_t c0 = __rdtsc();
+            while (std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(100)) {}
+            std::uint64_t c1 = __rdtsc();
+            ns_per_tick = 1e8 / static_cast<double>(c1 - c0);
+#endif
+        }
+
+#if defined(BENCH_RDTSC)
+        std::uint64_t now() const { return __rdtsc(); }
+        std::uint64_t ns(const std::uint64_t from, const std::uint64_t to) const {
+            return static_cast<std::uint64_t>((to - from) * ns_per_tick);
+        }
+    private:
+        double ns_per_tick;
+#else
+        std::chrono::steady_clock::time_point now() const { return std::chrono::steady_clock::now(); }
+        std::uint64_t ns(const std::chrono::steady_clock::time_point from, const std::chrono::steady_clock::time_point to) const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+        }
+#endif
+};
+
+class position_generator {
+    public:
+        position_generator(const std::string& d, std::mt19937_64& g):dist(d), gen(g), unit(0.0, 1.0) {
+            if (dist != "uniform" && dist != "front" && dist != "back" && dist != "hot")
+                throw std::invalid_argument("unknown distribution: " + dist);
+        }
+
+        // A position in [0, n), n > 0.
+        std::size_t operator()(const std::size_t n) {
+            double u = unit(gen);
+            if (dist == "front") u = u * u * u;
+            else if (dist == "back") u = 1 - u * u * u;
+            else if (dist == "hot") u = unit(gen) < 0.9 ? u * 0.01 : u;     // 90% within the first 1%
+            std::size_t p = static_cast<std::size_t>(u * n);
+            return p < n ? p : n - 1;
+        }
+
+    private:
+        std::string dist;
+        std::mt19937_64& gen;
+        std::uniform_real_distribution<double> unit;
+};
+
+static const char* counters_unavailable_reason(const perf_counters& pc) {
+#if defined(__linux__)
+    switch (pc.error(perf_counters::cycles)) {
+        case EACCES: case EPERM: return "perf_event_paranoid too high";
+        case ENOENT: case EOPNOTSUPP: case ENODEV: return "no hardware PMU, e.g. in a VM or container";
+        case ENOSYS: return "kernel without perf events";
+        default: return "perf_event_open failed";
+    }
+#else
+    (void)pc;
+    return "not Linux";
+#endif
+}
+
+// Runs count operations of kind op with the counters on. Positions are drawn
+// beforehand so the generator is not counted. Returns how many ran (erase
+// stops when the container is empty).
+static long count_op(const int op, const options& o, const long count, position_generator& where,
+                     perf_counters& pc, long& sink) {
+    container c;
+    for (long i = 0; i < o.size; ++i) c.push_back(i);
+    std::vector<std::size_t> pos;
+    std::size_t n = c.size();
+    for (long i = 0; i < count && op != op_push_back; ++i) {
+        if (op == op_erase && n == 0) break;
+        pos.push_back(n == 0 ? 0 : where(n));
+        if (op == op_insert) ++n;
+        else if (op == op_erase) --n;
+    }
+    long ran = op == op_push_back ? count : static_cast<long>(pos.size());
+
+    pc.start();
+    if (op == op_push_back) for (long i = 0; i < ran; ++i) c.push_back(i);
+    else if (op == op_insert) for (long i = 0; i < ran; ++i) c.insert(c.begin() + pos[i], i);
+    else if (op == op_erase) for (long i = 0; i < ran; ++i) c.erase(c.begin() + pos[i]);
+    else if (op == op_index) for (long i = 0; i < ran; ++i) sink += c[pos[i]];
+    else {
+        for (long i = 0; i < ran; ++i) {
+            std::size_t len = std::min<std::size_t>(o.walk, c.size() - pos[i]);
+            for (container::iterator it = c.begin() + pos[i], e = it + len; it != e; ++it) sink += *it;
+        }
+    }
+    pc.stop();
+    return ran;
+}
+
+static options parse(int argc, char* argv[]) {
+    options o;
+    o.size = 100000;
+    o.ops = 1000000;
+    o.walk = 64;
+    o.seed = 1;
+    const double mix[op_count] = { 20, 20, 20, 30, 10 };
+    std::copy(mix, mix + op_count, o.mix);
+    o.dist = "uniform";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i], val = argv[i + 1];
+        if (key == "--size") o.size = std::atol(val.c_str());
+        else if (key == "--ops") o.ops = std::atol(val.c_str());
+        else if (key == "--walk") o.walk = std::atol(val.c_str());
+        else if (key == "--seed") o.seed = std::atol(val.c_str());
+        else if (key == "--dist") o.dist = val;
+        else if (key == "--csv") o.csv = val;
+        else if (key == "--mix") {
+            char* p = const_cast<char*>(val.c_str());
+            for (int k = 0; k < op_count; ++k) {
+                o.mix[k] = std::strtod(p, &p);
+                if (*p == ',') ++p;
+            }
+        }
+        else throw std::invalid_argument("unknown option: " + key);
+    }
+    return o;
+}
+
+int main(int argc, char* argv[]) {
+    options o;
+    try {
+        o = parse(argc, argv);
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::mt19937_64 gen(o.seed);
+    std::discrete_distribution<int> pick(o.mix, o.mix + op_count);
+    position_generator where(o.dist, gen);
+    bench_timer timer;
+    std::vector<latency_histogram> h(op_count);
+
+    allocation_stats stats(op_count);
+    container c((container::allocator_type(&stats)));
+    for (long i = 0; i < o.size; ++i) c.push_back(i);
+    stats.reset();
+
+    long sink = 0;
+    for (long i = 0; i < o.ops; ++i) {
+        int op = pick(gen);
+        if (c.empty() && op != op_push_back) op = op_insert;
+        std::size_t p = c.empty() ? 0 : where(c.size());
+        stats.set_op(op);
+        if (op == op_push_back) {
+            auto t0 = timer.now();
+            c.push_back(i);
+            h[op].record(timer.ns(t0, timer.now()));
+        }
+        else if (op == op_insert) {
+            auto t0 = timer.now();
+            c.insert(c.begin() + p, i);
+            h[op].record(timer.ns(t0, timer.now()));
+        }
+        else if (op == op_erase) {
+            auto t0 = timer.now();
+            c.erase(c.begin() + p);
+            h[op].record(timer.ns(t0, timer.now()));
+        }
+        else if (op == op_index) {
+            auto t0 = timer.now();
+            sink += c[p];
+            h[op].record(timer.ns(t0, timer.now()));
+        }
+        else {
+            std::size_t len = std::min<std::size_t>(o.walk, c.size() - p);
+            auto t0 = timer.now();
+            for (container::iterator it = c.begin() + p, e = it + len; it != e; ++it) sink += *it;
+            h[op].record(timer.ns(t0, timer.now()));
+        }
+    }
+
+    perf_counters pc;
+    if (!pc.any_available())
+        std::cerr << "hardware counters unavailable (" << counters_unavailable_reason(pc) << "); writing NA" << std::endl;
+
+    std::ofstream file;
+    if (!o.csv.empty()) file.open(o.csv.c_str());
+    std::ostream& out = o.csv.empty() ? std::cout : file;
+    out << "impl,op,dist,size,count,p50_ns,p99_ns,p99.9_ns,max_ns";
+    for (int e = 0; e < perf_counters::event_count; ++e) out << ',' << perf_counters::name(static_cast<perf_counters::event>(e)) << "_per_op";
+    out << ",allocs_per_op,frees_per_op,alloc_bytes_per_op" << std::endl;
+    for (int k = 0; k < op_count; ++k) {
+        out << impl_name << ',' << op_names[k] << ',' << o.dist << ',' << o.size << ',' << h[k].count()
+            << ',' << h[k].percentile(50) << ',' << h[k].percentile(99) << ',' << h[k].percentile(99.9)
+            << ',' << h[k].max();
+        long ran = h[k].count() ? count_op(k, o, h[k].count(), where, pc, sink) : 0;
+        for (int e = 0; e < perf_counters::event_count; ++e) {
+            perf_counters::event ev = static_cast<perf_counters::event>(e);
+            if (pc.available(ev) && ran) out << ',' << static_cast<double>(pc[ev]) / ran;
+            else out << ",NA";
+        }
+        const allocation_stats::counters& a = stats.for_op(k);
+        double ops = h[k].count() ? static_cast<double>(h[k].count()) : 1;
+        out << ',' << a.allocations / ops << ',' << a.deallocations / ops << ',' << a.bytes_allocated / ops << std::endl;
+    }
+    std::cerr << "allocator (" << impl_name << ", mix only): " << stats << std::endl;
+    if (sink == 42) std::cerr << sink << std::endl;
+    return 0;
+}
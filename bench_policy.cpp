@@ -0,0 +1,107 @@
+//
+//  bench_policy.cpp
+//  HW6
+//
+//  policy_stable_vector under every combination of index backend (flat,
+//  segmented, gap), node allocation (individual, pool, slab) and fix-up
+//  (eager, deferred). Each combination runs the same phases on its own
+//  container and reports milliseconds per phase:
+//      push_back   grow from empty to n
+//      insert      random iterator inserts and erases (ops of each)
+//      local       positional inserts/erases around a slowly moving cursor
+//      read        random operator[]
+//      walk        one full iterator pass
+//      churn       clear and refill to n, three times
+//
+//  Usage: bench_policy [n] [ops]   (default 200000 2000; random inserts
+//         into the flat and gap indexes are O(n) each, so ops dominates)
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "policy_stable_vector.hpp"
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double ms_since(const bench_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+template<typename Policy>
+void run(const std::string& name, const long n, const long ops) {
+    typedef policy_stable_vector<long, Policy> container;
+    std::mt19937_64 gen(1);
+    long sink = 0;
+    container c;
+
+    bench_clock::time_point t0 = bench_clock::now();
+    for (long i = 0; i < n; ++i) c.push_back(i);
+    double push_ms = ms_since(t0);
+
+    t0 = bench_clock::now();
+    for (long i = 0; i < ops; ++i) {
+        c.insert(c.begin() + gen() % (c.size() + 1), i);
+        c.erase(c.begin() + gen() % c.size());
+    }
+    double insert_ms = ms_since(t0);
+
+    t0 = bench_clock::now();
+    std::size_t cursor = c.size() / 2;
+    for (long i = 0; i < ops; ++i) {
+        cursor = (cursor + gen() % 9 + c.size() - 4) % c.size();
+        c.insert_at(cursor, i);
+        c.erase_at((cursor + gen() % 5) % c.size());
+    }
+    double local_ms = ms_since(t0);
+
+    t0 = bench_clock::now();
+    for (long i = 0; i < n; ++i) sink += c[gen() % c.size()];
+    double read_ms = ms_since(t0);
+
+    t0 = bench_clock::now();
+    for (typename container::const_iterator it = c.begin(); it != c.end(); ++it) sink += *it;
+    double walk_ms = ms_since(t0);
+
+    t0 = bench_clock::now();
+    for (int k = 0; k < 3; ++k) {
+        c.clear();
+        for (long i = 0; i < n; ++i) c.push_back(i);
+    }
+    double churn_ms = ms_since(t0);
+
+    std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << push_ms << std::setw(10) << insert_ms << std::setw(10) << local_ms
+              << std::setw(10) << read_ms << std::setw(10) << walk_ms << std::setw(10) << churn_ms << std::endl;
+    if (sink == 42) std::cerr << sink << std::endl;
+}
+
+template<template<typename> class Index, template<typename> class Allocation>
+void run_fixups(const std::string& name, const long n, const long ops) {
+    run<sv_policy::policy<Index, Allocation, sv_policy::eager_fixup> >(name + "/eager", n, ops);
+    run<sv_policy::policy<Index, Allocation, sv_policy::deferred_fixup> >(name + "/deferred", n, ops);
+}
+
+template<template<typename> class Index>
+void run_allocations(const std::string& name, const long n, const long ops) {
+    run_fixups<Index, sv_policy::individual_nodes>(name + "/individual", n, ops);
+    run_fixups<Index, sv_policy::pooled_nodes>(name + "/pool", n, ops);
+    run_fixups<Index, sv_policy::slab_nodes>(name + "/slab", n, ops);
+}
+
+int main(int argc, char* argv[]) {
+    const long n = argc > 1 ? std::atol(argv[1]) : 200000;
+    const long ops = argc > 2 ? std::atol(argv[2]) : 2000;
+    std::cout << "n = " << n << ", ops = " << ops << " (ms)" << std::endl;
+    std::cout << std::left << std::setw(32) << "index/allocation/fixup" << std::right
+              << std::setw(10) << "push_back" << std::setw(10) << "insert" << std::setw(10) << "local"
+              << std::setw(10) << "read" << std::setw(10) << "walk" << std::setw(10) << "churn" << std::endl;
+    run_allocations<sv_policy::flat_index>("flat", n, ops);
+    run_allocations<sv_policy::segmented_index>("segmented", n, ops);
+    run_allocations<sv_policy::gap_index>("gap", n, ops);
+    return 0;
+}
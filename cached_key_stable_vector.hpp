@@ -0,0 +1,280 @@
+#ifndef CACHED_KEY_STABLE_VECTOR_HPP
+#define CACHED_KEY_STABLE_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// stable_vector whose index slots are {node*, key}, the key being a small
+// copy of Projection()(element) kept in sync by every mutation. sort,
+// stable_sort, partition, lower_bound, upper_bound and find compare the
+// cached keys only, so they run over the contiguous index and touch a node
+// only to fix its up pointer or to hand out the hit. Elements are exposed as
+// const; change them through replace() or modify() so the key follows.
+template<typename T, typename Projection>
+class cached_key_stable_vector {
+    public:
+        typedef typename std::decay<decltype(Projection()(std::declval<const T&>()))>::type key_type;
+
+    private:
+        static_assert(sizeof(key_type)<=8 && std::is_trivially_copyable<key_type>::value,
+                      "cached_key_stable_vector: key must be trivially copyable and at most 8 bytes");
+
+        struct node_base;
+        struct node;
+        struct slot {
+            node_base* n;
+            key_type key;
+        };
+        typedef std::vector<slot> vector_type;
+
+        struct key_less {
+            bool operator()(const slot& a, const slot& b) const { return a.key<b.key; }
+        };
+
+    public:
+        typedef T value_type;
+        typedef const T& reference;
+        typedef const T& const_reference;
+        typedef const T* pointer;
+        typedef const T* const_pointer;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        class const_iterator;
+        typedef const_iterator iterator;
+
+        explicit cached_key_stable_vector(const Projection& p = Projection()):proj(p) {
+            v.push_back(slot());
+            v.back().n=&end_node;
+            update(v.begin());
+        }
+
+        cached_key_stable_vector(const cached_key_stable_vector& rhs):proj(rhs.proj) {
+            v.push_back(slot());
+            v.back().n=&end_node;
+            update(v.begin());
+            try {
+                reserve(rhs.size());
+                for (const_iterator it=rhs.begin(); it!=rhs.end(); ++it) push_back(*it);
+            }
+            catch(...) {
+                clear();
+                throw;
+            }
+        }
+
+        cached_key_stable_vector& operator=(const cached_key_stable_vector& rhs) {
+            cached_key_stable_vector(rhs).swap(*this);
+            return *this;
+        }
+
+        ~cached_key_stable_vector() { clear(); }
+
+        const_reference at(const size_type pos) const { return pos < size() ? (*this)[pos] : throw std::range_error("cached_key_stable_vector: out of range"); }
+        const_reference operator[](const size_type pos) const { return value(v[pos].n); }
+        const_reference front() const { return value(v.front().n); }
+        const_reference back() const { return value((v.end()-2)->n); }
+
+        // Cached key of the element at pos, read from the index only.
+        const key_type& key(const size_type pos) const { return v[pos].key; }
+
+        const_iterator begin() const { return const_iterator(v.front().n); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator end() const { return const_iterator(v.back().n); }
+        const_iterator cend() const { return end(); }
+
+        bool empty() const { return v.size()==1; }
+        size_type size() const { return v.size()-1; }
+        size_type capacity() const { return v.capacity()-1; }
+
+        void reserve(const size_type n) {
+            v.reserve(n+1);
+            update(v.begin());
+        }
+
+        void clear() { erase(cbegin(), cend()); }
+
+        void push_back(const T& value) { insert(cend(), value); }
+        void pop_back() { if (!empty()) erase(cend()-1); }
+
+        iterator insert(const_iterator pos, const T& value) {
+            difference_type d=pos-cbegin();
+            slot s={nullptr, proj(value)};
+            node* n=new node(value);
+            s.n=n;
+            typename vector_type::iterator it;
+            try { it=v.insert(v.begin()+d, s); }
+            catch(...) { delete n; throw; }
+            n->up=it;   //插在最前面時 update() 會先讀它
+            update(it);
+            return begin()+d;
+        }
+
+        iterator erase(const_iterator pos) { return erase(pos, pos+1); }
+        iterator erase(const_iterator first, const_iterator last) {
+            difference_type d1=first-cbegin(), d2=last-cbegin();
+            for (difference_type f=d1; f!=d2; ++f) delete static_cast<node*>(v[f].n);
+            typename vector_type::iterator it=v.erase(v.begin()+d1, v.begin()+d2);
+            update(it);
+            return begin()+d1;
+        }
+
+        // proj throwing leaves the element untouched; T's assignment throwing
+        // leaves the key of whatever the element then holds.
+        void replace(const_iterator pos, const T& value) {
+            node* n=static_cast<node*>(pos.n);
+            const key_type k=proj(value);
+            try { n->datum=value; }
+            catch(...) { n->up->key=proj(n->datum); throw; }
+            n->up->key=k;
+        }
+
+        // Applies f to the element in place and re-reads its key.
+        template<typename Function>
+        void modify(const_iterator pos, Function f) {
+            node* n=static_cast<node*>(pos.n);
+            try { f(n->datum); }
+            catch(...) { n->up->key=proj(n->datum); throw; }
+            n->up->key=proj(n->datum);
+        }
+
+        // Only slots move; each node is written once to fix its up pointer.
+        void sort() {
+            std::sort(v.begin(), v.end()-1, key_less());
+            update(v.begin());
+        }
+        void stable_sort() {
+            std::stable_sort(v.begin(), v.end()-1, key_less());
+            update(v.begin());
+        }
+
+        // Moves the elements whose key satisfies pred to the front; returns
+        // the first element of the second group.
+        template<typename Predicate>
+        iterator partition(Predicate pred) {
+            typename vector_type::iterator mid=std::partition(v.begin(), v.end()-1, key_predicate<Predicate>(pred));
+            update(v.begin());
+            return const_iterator(mid->n);
+        }
+
+        // Require the container to be sorted by key.
+        iterator lower_bound(const key_type& k) const {
+            return const_iterator(std::lower_bound(v.begin(), v.end()-1, probe(k), key_less())->n);
+        }
+        iterator upper_bound(const key_type& k) const {
+            return const_iterator(std::upper_bound(v.begin(), v.end()-1, probe(k), key_less())->n);
+        }
+
+        // Linear scan over the cached keys.
+        iterator find(const key_type& k) const {
+            typename vector_type::const_iterator a=v.begin();
+            for (; a!=v.end()-1; ++a) if (a->key==k) break;
+            return const_iterator(a->n);
+        }
+
+        // end() stays with its container, so end iterators are not swapped.
+        void swap(cached_key_stable_vector& other) {
+            v.swap(other.v);
+            std::swap(proj, other.proj);
+            v.back().n=&end_node;
+            other.v.back().n=&other.end_node;
+            update(v.begin());
+            other.update(other.v.begin());
+        }
+
+        friend bool operator==(const cached_key_stable_vector& lhs, const cached_key_stable_vector& rhs) {
+            return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+        }
+        friend bool operator!=(const cached_key_stable_vector& lhs, const cached_key_stable_vector& rhs) { return !(lhs == rhs); }
+
+        class const_iterator {
+            friend class cached_key_stable_vector;
+
+            public:
+                typedef cached_key_stable_vector::difference_type difference_type;
+                typedef T value_type;
+                typedef const T* pointer;
+                typedef const T& reference;
+                typedef std::random_access_iterator_tag iterator_category;
+
+                const_iterator():n(nullptr) {}
+                explicit const_iterator(node_base* const n_):n(n_) {}
+
+                reference operator*() const { return value(n); }
+                pointer operator->() const { return std::addressof(operator*()); }
+                reference operator[](const difference_type i) const { return value(n->up[i].n); }
+
+                const_iterator& operator+=(const difference_type i) { n=n->up[i].n; return *this; }
+                const_iterator& operator-=(const difference_type i) { return *this+=-i; }
+
+                friend const_iterator operator+(const_iterator it, const difference_type i) { return it+=i; }
+                friend const_iterator operator+(const difference_type i, const_iterator it) { return it+=i; }
+                friend const_iterator operator-(const_iterator it, const difference_type i) { return it-=i; }
+                friend difference_type operator-(const const_iterator lhs, const const_iterator rhs) { return lhs.n->up-rhs.n->up; }
+
+                const_iterator& operator++() { n=n->up[1].n; return *this; }
+                const_iterator operator++(int) {
+                    const_iterator it(*this);
+                    ++*this;
+                    return it;
+                }
+
+                const_iterator& operator--() { n=n->up[-1].n; return *this; }
+                const_iterator operator--(int) {
+                    const_iterator it(*this);
+                    --*this;
+                    return it;
+                }
+
+                friend bool operator==(const const_iterator lhs, const const_iterator rhs) { return lhs.n==rhs.n; }
+                friend bool operator!=(const const_iterator lhs, const const_iterator rhs) { return !(lhs==rhs); }
+                friend bool operator< (const const_iterator lhs, const const_iterator rhs) { return (lhs-rhs)<0; }
+                friend bool operator<=(const const_iterator lhs, const const_iterator rhs) { return !(rhs<lhs); }
+                friend bool operator> (const const_iterator lhs, const const_iterator rhs) { return rhs<lhs; }
+                friend bool operator>=(const const_iterator lhs, const const_iterator rhs) { return !(lhs<rhs); }
+
+            private:
+                node_base* n;
+        };
+
+    private:
+        struct node_base {
+            node_base():up() {}
+            typename vector_type::iterator up;
+        };
+
+        struct node : node_base {
+            explicit node(const T& value):datum(value) {}
+            T datum;
+        };
+
+        template<typename Predicate>
+        struct key_predicate {
+            explicit key_predicate(Predicate p_):p(p_) {}
+            bool operator()(const slot& s) { return p(s.key); }
+            Predicate p;
+        };
+
+        vector_type v;      //v.back().n 是 &end_node
+        node_base end_node;
+        Projection proj;
+
+        static const T& value(const node_base* const n) { return static_cast<const node*>(n)->datum; }
+        static slot probe(const key_type& k) {
+            slot s={nullptr, k};
+            return s;
+        }
+
+        void update(typename vector_type::iterator a) {
+            if (a!=v.begin() && v.front().n->up!=v.begin()) a=v.begin();    //之前已reallocate
+            for (; a!=v.end(); ++a) a->n->up=a;
+        }
+};
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef COUNTING_ALLOCATOR_HPP
+#define COUNTING_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// What a container asked of its allocator. Give each container its own
+// allocation_stats (through its counting_allocator) to get per-container
+// numbers; set_op() attributes the following requests to an operation type.
+class allocation_stats {
+    public:
+        enum { size_classes=64 };     //class k: [2^k, 2^(k+1)) bytes
+
+        struct counters {
+            counters():allocations(0), deallocations(0), bytes_allocated(0), bytes_deallocated(0) {}
+            std::uint64_t allocations, deallocations;
+            std::uint64_t bytes_allocated, bytes_deallocated;
+        };
+
+        explicit allocation_stats(const std::size_t op_types = 1)
+            :per_op(op_types), op(0), live(0), high_water(0), histogram(size_classes, 0) {}
+
+        void set_op(const std::size_t k) { op=k; }
+        std::size_t current_op() const { return op; }
+
+        void on_allocate(const std::size_t bytes) {
+            ++total.allocations;
+            total.bytes_allocated+=bytes;
+            ++per_op[op].allocations;
+            per_op[op].bytes_allocated+=bytes;
+            ++histogram[size_class(bytes)];
+            live+=bytes;
+            if (live>high_water) high_water=live;
+        }
+
+        void on_deallocate(const std::size_t bytes) {
+            ++total.deallocations;
+            total.bytes_deallocated+=bytes;
+            ++per_op[op].deallocations;
+            per_op[op].bytes_deallocated+=bytes;
+            live-=bytes;
+        }
+
+        // Forgets the counts but keeps the live bytes, which still belong to
+        // the container; the high-water mark restarts from them.
+        void reset() {
+            total=counters();
+            for (std::size_t k=0; k<per_op.size(); ++k) per_op[k]=counters();
+            for (std::size_t k=0; k<histogram.size(); ++k) histogram[k]=0;
+            high_water=live;
+        }
+
+        const counters& all() const { return total; }
+        const counters& for_op(const std::size_t k) const { return per_op[k]; }
+        std::uint64_t live_bytes() const { return live; }
+        std::uint64_t high_water_bytes() const { return high_water; }
+        std::uint64_t in_size_class(const std::size_t k) const { return histogram[k]; }
+
+        static std::size_t size_class(std::size_t bytes) {
+            std::size_t k=0;
+            while (bytes>1) { bytes>>=1; ++k; }
+            return k;
+        }
+
+        // "allocs=.. frees=.. bytes=.. live=.. high_water=.. classes=[8:12 16:3 ...]"
+        friend std::ostream& operator<<(std::ostream& out, const allocation_stats& s) {
+            out << "allocs=" << s.total.allocations << " frees=" << s.total.deallocations
+                << " bytes=" << s.total.bytes_allocated << " live=" << s.live << " high_water=" << s.high_water << " classes=[";
+            bool first=true;
+            for (std::size_t k=0; k<s.histogram.size(); ++k) {
+                if (!s.histogram[k]) continue;
+                out << (first ? "" : " ") << (std::uint64_t(1)<<k) << ':' << s.histogram[k];
+                first=false;
+            }
+            return out << ']';
+        }
+
+    private:
+        counters total;
+        std::vector<counters> per_op;
+        std::size_t op;
+        std::uint64_t live, high_water;
+        std::vector<std::uint64_t> histogram;
+};
+
+// Allocator adapter that reports every request to an allocation_stats and
+// forwards it to Base. A default-constructed one (no stats) just forwards.
+// It has the full C++03 allocator interface (rebind, construct, ...) so the
+// Boost-based stable_vector1.hpp and stable_vector2.hpp accept it as well as
+// stable_vector.hpp.
+template<typename T, typename Base = std::allocator<T> >
+class counting_allocator {
+    private:
+        typedef std::allocator_traits<Base> base_traits;
+
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        template<typename U>
+        struct rebind { typedef counting_allocator<U, typename base_traits::template rebind_alloc<U> > other; };
+
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        counting_allocator():stats(nullptr) {}
+        explicit counting_allocator(allocation_stats* const s, const Base& b = Base()):stats(s), base(b) {}
+        template<typename U, typename B>
+        counting_allocator(const counting_allocator<U, B>& rhs):stats(rhs.stats), base(rhs.base) {}
+
+        pointer allocate(const size_type n, const void* = nullptr) {
+            pointer p=base_traits::allocate(base, n);
+            if (stats) stats->on_allocate(n*sizeof(T));
+            return p;
+        }
+
+        void deallocate(const pointer p, const size_type n) {
+            if (stats) stats->on_deallocate(n*sizeof(T));
+            base_traits::deallocate(base, p, n);
+        }
+
+        template<typename U, typename... Args>
+        void construct(U* const p, Args&&... args) { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+        template<typename U>
+        void destroy(U* const p) { p->~U(); }
+
+        size_type max_size() const { return base_traits::max_size(base); }
+        pointer address(reference x) const { return std::addressof(x); }
+        const_pointer address(const_reference x) const { return std::addressof(x); }
+
+        allocation_stats* statistics() const { return stats; }
+
+        template<typename U, typename B>
+        bool operator==(const counting_allocator<U, B>& rhs) const { return stats==rhs.stats; }
+        template<typename U, typename B>
+        bool operator!=(const counting_allocator<U, B>& rhs) const { return stats!=rhs.stats; }
+
+    private:
+        template<typename, typename> friend class counting_allocator;
+
+        allocation_stats* stats;
+        Base base;
+};
+
+// Like std::allocator<void> before C++20: only rebinds and converts, for
+// containers (stable_vector2.hpp) that rebind their allocator to void.
+template<typename Base>
+class counting_allocator<void, Base> {
+    public:
+        typedef void value_type;
+        typedef void* pointer;
+        typedef const void* const_pointer;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        template<typename U>
+        struct rebind { typedef counting_allocator<U, typename std::allocator_traits<Base>::template rebind_alloc<U> > other; };
+
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        counting_allocator():stats(nullptr) {}
+        explicit counting_allocator(allocation_stats* const s, const Base& b = Base()):stats(s), base(b) {}
+        template<typename U, typename B>
+        counting_allocator(const counting_allocator<U, B>& rhs):stats(rhs.stats), base(rhs.base) {}
+
+        allocation_stats* statistics() const { return stats; }
+
+        template<typename U, typename B>
+        bool operator==(const counting_allocator<U, B>& rhs) const { return stats==rhs.stats; }
+        template<typename U, typename B>
+        bool operator!=(const counting_allocator<U, B>& rhs) const { return stats!=rhs.stats; }
+
+    private:
+        template<typename, typename> friend class counting_allocator;
+
+        allocation_stats* stats;
+        Base base;
+};
+
+#endif
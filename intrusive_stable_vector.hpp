@@ -0,0 +1,219 @@
+#ifndef INTRUSIVE_STABLE_VECTOR_HPP
+#define INTRUSIVE_STABLE_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Hook that an object embeds (by deriving from it) to be linked into an
+// intrusive_stable_vector. up points at the object's slot in the index, or
+// is nullptr while the object is not linked. Copying an object does not copy
+// its linkage.
+class stable_vector_hook {
+    public:
+        stable_vector_hook():up(nullptr) {}
+        stable_vector_hook(const stable_vector_hook&):up(nullptr) {}
+        stable_vector_hook& operator=(const stable_vector_hook&) { return *this; }
+
+        bool is_linked() const { return up!=nullptr; }
+
+    private:
+        template<typename> friend class intrusive_stable_vector;
+
+        stable_vector_hook** up;
+};
+
+// stable_vector over caller-owned objects. T derives from stable_vector_hook,
+// which plays the role of the node's up pointer, so the container allocates
+// nothing per element: insert and erase only link and unlink. The objects
+// must outlive their membership; erase, clear and the destructor unlink them
+// but never destroy them. An object can be in one container at a time.
+template<typename T>
+class intrusive_stable_vector {
+    private:
+        typedef stable_vector_hook hook;
+        typedef std::vector<hook*> vector_type;
+
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        template<typename Value> class hook_iterator;
+        typedef hook_iterator<T> iterator;
+        typedef hook_iterator<const T> const_iterator;
+
+        intrusive_stable_vector():v(1, &end_hook) { update(v.begin()); }
+
+        intrusive_stable_vector(const intrusive_stable_vector&) = delete;
+        intrusive_stable_vector& operator=(const intrusive_stable_vector&) = delete;
+
+        ~intrusive_stable_vector() { clear(); }
+
+        reference at(const size_type pos) { return pos < size() ? (*this)[pos] : throw std::range_error("intrusive_stable_vector: out of range"); }
+        const_reference at(const size_type pos) const { return pos < size() ? (*this)[pos] : throw std::range_error("intrusive_stable_vector: out of range"); }
+
+        reference operator[](const size_type pos) { return value(v[pos]); }
+        const_reference operator[](const size_type pos) const { return value(v[pos]); }
+
+        reference front() { return value(v.front()); }
+        const_reference front() const { return value(v.front()); }
+
+        reference back() { return value(*(v.end()-2)); }
+        const_reference back() const { return value(*(v.end()-2)); }
+
+        iterator begin() { return iterator(v.front()); }
+        const_iterator begin() const { return const_iterator(v.front()); }
+        const_iterator cbegin() const { return begin(); }
+
+        iterator end() { return iterator(v.back()); }
+        const_iterator end() const { return const_iterator(v.back()); }
+        const_iterator cend() const { return end(); }
+
+        bool empty() const { return v.size()==1; }
+        size_type size() const { return v.size()-1; }
+        size_type capacity() const { return v.capacity()-1; }
+
+        void reserve(const size_type n) {
+            v.reserve(n+1);
+            update(v.begin());
+        }
+
+        //O(1): 由 hook 的 up 算出位置, x 必須在這個 container 裡
+        size_type index_of(const_reference x) const { return static_cast<const hook&>(x).up-v.data(); }
+        iterator iterator_to(reference x) { return iterator(&x); }
+        const_iterator iterator_to(const_reference x) const { return const_iterator(const_cast<hook*>(static_cast<const hook*>(&x))); }
+
+        void clear() { erase(cbegin(), cend()); }
+
+        void push_back(reference x) { insert(cend(), x); }
+        void pop_back() { if (!empty()) erase(cend()-1); }
+
+        iterator insert(const_iterator pos, reference x) {
+            hook* h=&x;
+            if (h->is_linked()) throw std::invalid_argument("intrusive_stable_vector: object is already linked");
+            difference_type d=pos-cbegin();
+            typename vector_type::iterator it=v.insert(v.begin()+d, h);
+            update(it);
+            return begin()+d;
+        }
+        // All or nothing: if any object is already linked, or appears twice
+        // in [first, last), nothing is linked and invalid_argument is thrown.
+        template<typename ForwardIterator>
+        iterator insert(const_iterator pos, ForwardIterator first, ForwardIterator last) {
+            difference_type d=pos-cbegin();
+            vector_type w;
+            typename vector_type::iterator it;
+            try {
+                for (; first!=last; ++first) {
+                    hook* h=&*first;
+                    if (h->is_linked()) throw std::invalid_argument("intrusive_stable_vector: object is already linked");
+                    w.push_back(h);
+                    h->up=&w.back();    //先標記, 同一個物件再出現就會被擋下
+                }
+                it=v.insert(v.begin()+d, w.begin(), w.end());
+            }
+            catch (...) {
+                for (hook* h : w) h->up=nullptr;
+                throw;
+            }
+            update(it);
+            return begin()+d;
+        }
+
+        iterator erase(const_iterator pos) { return erase(pos, pos+1); }
+        iterator erase(const_iterator first, const_iterator last) {
+            difference_type d1=first-cbegin(), d2=last-cbegin();
+            for (difference_type f=d1; f!=d2; ++f) v[f]->up=nullptr;
+            typename vector_type::iterator it=v.erase(v.begin()+d1, v.begin()+d2);
+            update(it);
+            return begin()+d1;
+        }
+
+        // end() stays with its container, so end iterators are not swapped.
+        void swap(intrusive_stable_vector& other) {
+            v.swap(other.v);
+            v.back()=&end_hook;
+            other.v.back()=&other.end_hook;
+            update(v.begin());
+            other.update(other.v.begin());
+        }
+
+        template<typename Value>
+        class hook_iterator {
+            friend class intrusive_stable_vector;
+
+            public:
+                typedef intrusive_stable_vector::difference_type difference_type;
+                typedef typename std::remove_const<Value>::type value_type;
+                typedef Value* pointer;
+                typedef Value& reference;
+                typedef std::random_access_iterator_tag iterator_category;
+
+                hook_iterator():n(nullptr) {}
+                explicit hook_iterator(hook* const n_):n(n_) {}
+                hook_iterator(const hook_iterator<T>& rhs):n(rhs.n) {}
+
+                reference operator*() const { return value(n); }
+                pointer operator->() const { return std::addressof(operator*()); }
+                reference operator[](const difference_type i) const { return value(n->up[i]); }
+
+                hook_iterator& operator+=(const difference_type i) { n=n->up[i]; return *this; }
+                hook_iterator& operator-=(const difference_type i) { return *this+=-i; }
+
+                friend hook_iterator operator+(hook_iterator it, const difference_type i) { return it+=i; }
+                friend hook_iterator operator+(const difference_type i, hook_iterator it) { return it+=i; }
+                friend hook_iterator operator-(hook_iterator it, const difference_type i) { return it-=i; }
+                friend difference_type operator-(const hook_iterator lhs, const hook_iterator rhs) { return lhs.slot()-rhs.slot(); }
+
+                hook_iterator& operator++() { n=n->up[1]; return *this; }
+                hook_iterator operator++(int) {
+                    hook_iterator it(*this);
+                    ++*this;
+                    return it;
+                }
+
+                hook_iterator& operator--() { n=n->up[-1]; return *this; }
+                hook_iterator operator--(int) {
+                    hook_iterator it(*this);
+                    --*this;
+                    return it;
+                }
+
+                friend bool operator==(const hook_iterator lhs, const hook_iterator rhs) { return lhs.n==rhs.n; }
+                friend bool operator!=(const hook_iterator lhs, const hook_iterator rhs) { return !(lhs==rhs); }
+                friend bool operator< (const hook_iterator lhs, const hook_iterator rhs) { return (lhs-rhs)<0; }
+                friend bool operator<=(const hook_iterator lhs, const hook_iterator rhs) { return !(rhs<lhs); }
+                friend bool operator> (const hook_iterator lhs, const hook_iterator rhs) { return rhs<lhs; }
+                friend bool operator>=(const hook_iterator lhs, const hook_iterator rhs) { return !(lhs<rhs); }
+
+            private:
+                hook** slot() const { return n->up; }
+
+                hook* n;
+
+                template<typename> friend class hook_iterator;
+        };
+
+    private:
+        vector_type v;      //v.back() 是 &end_hook
+        hook end_hook;
+
+        static T& value(hook* const h) { return static_cast<T&>(*h); }
+
+        void update(typename vector_type::iterator a) {
+            if (v.front()->up!=v.data()) a=v.begin();    //之前已reallocate
+            for (; a!=v.end(); ++a) (*a)->up=&*a;
+        }
+};
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef KEYED_STABLE_VECTOR_HPP
+#define KEYED_STABLE_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "stable_vector.hpp"
+
+// stable_vector with a secondary hash index on KeyOf()(element). The index
+// is an open-addressing (linear probing) table of element addresses, which
+// stable_vector keeps stable, so no allocation happens per element. Every
+// mutation goes through this class and keeps the table in sync; elements
+// are only handed out as const so keys cannot change behind its back (use
+// replace() instead). With duplicate keys find_by_key returns one of them.
+template<typename T, typename KeyOf, typename Hash = std::hash<typename std::decay<decltype(KeyOf()(std::declval<const T&>()))>::type>,
+         typename KeyEqual = std::equal_to<typename std::decay<decltype(KeyOf()(std::declval<const T&>()))>::type> >
+class keyed_stable_vector {
+    private:
+        typedef stable_vector<T> base_type;
+
+    public:
+        typedef T value_type;
+        typedef typename std::decay<decltype(KeyOf()(std::declval<const T&>()))>::type key_type;
+        typedef typename base_type::const_reference reference;
+        typedef typename base_type::const_reference const_reference;
+        typedef typename base_type::size_type size_type;
+        typedef typename base_type::difference_type difference_type;
+        typedef typename base_type::const_iterator iterator;
+        typedef typename base_type::const_iterator const_iterator;
+
+        explicit keyed_stable_vector(const KeyOf& k = KeyOf(), const Hash& h = Hash(), const KeyEqual& e = KeyEqual())
+            :key_of(k), hash(h), equal(e) {}
+
+        keyed_stable_vector(const keyed_stable_vector& rhs)
+            :v(rhs.v), key_of(rhs.key_of), hash(rhs.hash), equal(rhs.equal) { rebuild(); }
+
+        keyed_stable_vector& operator=(const keyed_stable_vector& rhs) {
+            keyed_stable_vector(rhs).swap(*this);
+            return *this;
+        }
+
+        const_iterator begin() const { return v.cbegin(); }
+        const_iterator end() const { return v.cend(); }
+        const_iterator cbegin() const { return v.cbegin(); }
+        const_iterator cend() const { return v.cend(); }
+
+        const_reference operator[](const size_type pos) const { return v[pos]; }
+        const_reference at(const size_type pos) const { return v.at(pos); }
+        const_reference front() const { return v.front(); }
+        const_reference back() const { return v.back(); }
+
+        bool empty() const { return v.empty(); }
+        size_type size() const { return v.size(); }
+
+        // O(1) expected; end() if no element has this key.
+        const_iterator find_by_key(const key_type& key) const {
+            if (table.empty()) return end();
+            for (size_type i=hash(key)&mask();; i=(i+1)&mask()) {
+                if (!table[i]) return end();
+                if (equal(key_of(*table[i]), key)) return v.iterator_to(*table[i]);
+            }
+        }
+        bool contains_key(const key_type& key) const { return find_by_key(key)!=end(); }
+
+        // O(1) through the node's back-pointer.
+        size_type index_of(const_reference x) const { return v.index_of(x); }
+
+        void push_back(const T& value) { insert(cend(), value); }
+        void pop_back() { if (!empty()) erase(cend()-1); }
+
+        iterator insert(const_iterator pos, const T& value) {
+            reserve_table(size()+1);
+            iterator it=v.insert(pos, value);
+            table_insert(&*it);
+            return it;
+        }
+
+        iterator erase(const_iterator pos) { return erase(pos, pos+1); }
+        iterator erase(const_iterator first, const_iterator last) {
+            for (const_iterator it=first; it!=last; ++it) table_erase(&*it);
+            return v.erase(first, last);
+        }
+
+        // Replaces the element at pos, re-indexing it under its new key.
+        void replace(const_iterator pos, const T& value) {
+            T& x=const_cast<T&>(*pos);
+            table_erase(&x);
+            try { x=value; }
+            catch(...) { table_insert(&x); throw; }
+            table_insert(&x);
+        }
+
+        void assign(const size_type n, const T& value) { v.assign(n, value); rebuild(); }
+        template<typename InputIterator>
+        void assign(InputIterator first, InputIterator last, typename std::enable_if<!std::is_integral<InputIterator>::value>::type* = nullptr) {
+            clear();
+            for (; first!=last; ++first) push_back(*first);
+        }
+
+        void clear() {
+            v.clear();
+            std::fill(table.begin(), table.end(), nullptr);
+        }
+
+        void swap(keyed_stable_vector& other) {
+            v.swap(other.v);
+            table.swap(other.table);
+            std::swap(key_of, other.key_of);
+            std::swap(hash, other.hash);
+            std::swap(equal, other.equal);
+        }
+
+        friend bool operator==(const keyed_stable_vector& lhs, const keyed_stable_vector& rhs) { return lhs.v==rhs.v; }
+        friend bool operator!=(const keyed_stable_vector& lhs, const keyed_stable_vector& rhs) { return lhs.v!=rhs.v; }
+
+    private:
+        size_type mask() const { return table.size()-1; }
+        size_type home(const T* const p) const { return hash(key_of(*p))&mask(); }
+
+        // Keeps the load factor at or below 1/2.
+        void reserve_table(const size_type n) {
+            if (2*n<=table.size()) return;
+            size_type cap=16;
+            while (cap<2*n) cap*=2;
+            std::vector<const T*> old(cap, nullptr);
+            old.swap(table);
+            for (typename std::vector<const T*>::const_iterator it=old.begin(); it!=old.end(); ++it)
+                if (*it) table_insert(*it);
+        }
+
+        void table_insert(const T* const p) {
+            size_type i=home(p);
+            while (table[i]) i=(i+1)&mask();
+            table[i]=p;
+        }
+
+        // Backward-shift deletion, so no tombstones are needed.
+        void table_erase(const T* const p) {
+            size_type i=home(p);
+            while (table[i]!=p) i=(i+1)&mask();
+            for (size_type j=(i+1)&mask(); table[j]; j=(j+1)&mask()) {
+                size_type h=home(table[j]);
+                if (((j-h)&mask())>=((j-i)&mask())) {
+                    table[i]=table[j];
+                    i=j;
+                }
+            }
+            table[i]=nullptr;
+        }
+
+        void rebuild() {
+            std::vector<const T*>().swap(table);
+            reserve_table(size());
+            for (const_iterator it=v.cbegin(); it!=v.cend(); ++it) table_insert(&*it);
+        }
+
+        base_type v;
+        KeyOf key_of;
+        Hash hash;
+        KeyEqual equal;
+        std::vector<const T*> table;   //one entry per element: the load is size()/table.size()
+};
+
+#endif
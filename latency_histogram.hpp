@@ -0,0 +1,61 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// HDR-style histogram of latencies in nanoseconds: every power of two is
+// split into 16 linear sub-buckets, so percentiles are within ~6%.
+class latency_histogram {
+    public:
+        latency_histogram():buckets(61*sub_buckets, 0), total(0), worst(0) {}
+
+        void record(const std::uint64_t ns) {
+            ++buckets[bucket(ns)];
+            ++total;
+            if (ns>worst) worst=ns;
+        }
+
+        void merge(const latency_histogram& rhs) {
+            for (std::size_t i=0; i<buckets.size(); ++i) buckets[i]+=rhs.buckets[i];
+            total+=rhs.total;
+            if (rhs.worst>worst) worst=rhs.worst;
+        }
+
+        // Upper bound of the bucket holding the p-th percentile, 0 <= p <= 100.
+        std::uint64_t percentile(const double p) const {
+            if (total==0) return 0;
+            std::uint64_t rank=static_cast<std::uint64_t>(p/100*total+0.5), seen=0;
+            if (rank==0) rank=1;
+            for (std::size_t i=0; i<buckets.size(); ++i) {
+                seen+=buckets[i];
+                if (seen>=rank) return upper(i)<worst ? upper(i) : worst;
+            }
+            return worst;
+        }
+
+        std::uint64_t max() const { return worst; }
+        std::uint64_t count() const { return total; }
+
+    private:
+        static const std::size_t sub_buckets=16;
+
+        static std::size_t bucket(const std::uint64_t ns) {
+            if (ns<sub_buckets) return static_cast<std::size_t>(ns);
+            int e=63;
+            while (!(ns>>e)) --e;       //e>=4
+            return (e-3)*sub_buckets+((ns>>(e-4))&(sub_buckets-1));
+        }
+
+        static std::uint64_t upper(const std::size_t i) {
+            if (i<sub_buckets) return i;
+            std::size_t e=i/sub_buckets+3, sub=i%sub_buckets;
+            return ((sub_buckets+sub+1)<<(e-4))-1;
+        }
+
+        std::vector<std::uint64_t> buckets;
+        std::uint64_t total, worst;
+};
+
+#endif
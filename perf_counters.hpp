@@ -0,0 +1,125 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters for the calling thread, read with perf_event_open on
+// Linux. Each event is opened on its own, so a machine (or VM, or a
+// perf_event_paranoid setting) that lacks one event still reports the
+// others. An event that could not be opened reports available(e) == false
+// and error(e) holds the errno of the attempt; off Linux nothing is
+// available and start()/stop() do nothing. Counts are
+// scaled when the kernel had to multiplex the events.
+class perf_counters {
+    public:
+        enum event { cycles, instructions, l1d_misses, llc_misses, dtlb_misses, branch_misses, event_count };
+
+        static const char* name(const event e) {
+            static const char* const names[event_count] = {
+                "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses"
+            };
+            return names[e];
+        }
+
+        perf_counters() {
+            for (int e = 0; e < event_count; ++e) {
+                fd[e] = -1;
+                err[e] = 0;
+                value[e] = 0;
+            }
+#if defined(__linux__)
+            for (int e = 0; e < event_count; ++e) {
+                fd[e] = open(static_cast<event>(e));
+                if (fd[e] < 0) err[e] = errno;
+            }
+#endif
+        }
+
+        perf_counters(const perf_counters&) = delete;
+        perf_counters& operator=(const perf_counters&) = delete;
+
+        ~perf_counters() {
+#if defined(__linux__)
+            for (int e = 0; e < event_count; ++e) if (fd[e] >= 0) close(fd[e]);
+#endif
+        }
+
+        bool available(const event e) const { return fd[e] >= 0; }
+        // errno from opening e: ENOENT/EOPNOTSUPP when the CPU or VM has no
+        // such counter, EACCES/EPERM when perf_event_paranoid forbids it.
+        int error(const event e) const { return err[e]; }
+        bool any_available() const {
+            for (int e = 0; e < event_count; ++e) if (available(static_cast<event>(e))) return true;
+            return false;
+        }
+
+        void start() {
+#if defined(__linux__)
+            for (int e = 0; e < event_count; ++e) {
+                if (fd[e] < 0) continue;
+                ioctl(fd[e], PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd[e], PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        void stop() {
+#if defined(__linux__)
+            for (int e = 0; e < event_count; ++e) if (fd[e] >= 0) ioctl(fd[e], PERF_EVENT_IOC_DISABLE, 0);
+            for (int e = 0; e < event_count; ++e) {
+                value[e] = 0;
+                if (fd[e] < 0) continue;
+                std::uint64_t r[3];    //value, time_enabled, time_running
+                if (read(fd[e], r, sizeof(r)) != static_cast<ssize_t>(sizeof(r))) continue;
+                value[e] = r[2] ? static_cast<std::uint64_t>(static_cast<double>(r[0]) * r[1] / r[2]) : 0;
+            }
+#endif
+        }
+
+        // Count between the last start() and stop().
+        std::uint64_t operator[](const event e) const { return value[e]; }
+
+    private:
+#if defined(__linux__)
+        static int open(const event e) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            switch (e) {
+                case cycles:        attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+                case instructions:  attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+                case branch_misses: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+                case l1d_misses:    attr.type = PERF_TYPE_HW_CACHE; attr.config = cache(PERF_COUNT_HW_CACHE_L1D); break;
+                case llc_misses:    attr.type = PERF_TYPE_HW_CACHE; attr.config = cache(PERF_COUNT_HW_CACHE_LL); break;
+                case dtlb_misses:   attr.type = PERF_TYPE_HW_CACHE; attr.config = cache(PERF_COUNT_HW_CACHE_DTLB); break;
+                default: return -1;
+            }
+            long r = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            return static_cast<int>(r);
+        }
+
+        static std::uint64_t cache(const std::uint64_t id) {
+            return id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+#endif
+
+        int fd[event_count];
+        int err[event_count];
+        std::uint64_t value[event_count];
+};
+
+#endif
@@ -0,0 +1,678 @@
+#ifndef POLICY_STABLE_VECTOR_HPP
+#define POLICY_STABLE_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Building blocks for policy_stable_vector. Every choice is a template
+// argument, so an unused strategy costs nothing at run time.
+namespace sv_policy {
+
+typedef std::size_t size_type;
+
+// ---- index backends: store Ptr values by logical position ----
+//
+// A node does not store its position but a locator handed out by the
+// backend, from which position() computes the position. Ptr must point to
+// something with a member `loc' of the backend's locator type. Edits return
+// the positions whose locators they made stale, and locate() rewrites them;
+// a backend that keeps positions relative to a segment only reports the
+// segments it touched.
+
+// [first, second): positions whose locators are stale after an edit.
+typedef std::pair<size_type, size_type> range;
+
+// One contiguous array; middle inserts move everything after them, and
+// the locator is the position itself, so everything after them is stale.
+template<typename Ptr>
+class flat_index {
+    public:
+        typedef size_type locator;
+
+        size_type size() const { return v.size(); }
+        Ptr operator[](const size_type i) const { return v[i]; }
+        Ptr& operator[](const size_type i) { return v[i]; }
+        size_type position(const locator l) const { return l; }
+
+        range insert(const size_type i, const size_type n, const Ptr p) {
+            v.insert(v.begin()+i, n, p);
+            return range(i, v.size());
+        }
+        range erase(const size_type i, const size_type j) {
+            v.erase(v.begin()+i, v.begin()+j);
+            return range(i, v.size());
+        }
+        range reserve(const size_type n) {
+            v.reserve(n);
+            return range(0, 0);
+        }
+        void clear() { v.clear(); }
+        void swap(flat_index& other) { v.swap(other.v); }
+
+        void locate(size_type i, const size_type j) { for (; i<j; ++i) v[i]->loc=i; }
+
+        // f(ptr, position) for every position from first on, in order.
+        template<typename Function>
+        void visit(size_type first, Function f) const { for (; first<v.size(); ++first) f(v[first], first); }
+
+    private:
+        std::vector<Ptr> v;
+};
+
+// Blocks of at most block_size pointers; an insert or erase only moves
+// pointers inside one block plus the block start table. A locator is the
+// block and the offset in it, so only the entries of the blocks an edit
+// touched need new locators; the blocks' own start positions are kept
+// current on every edit, which costs one add per block.
+template<typename Ptr>
+class segmented_index {
+    private:
+        struct segment {
+            segment():start(0) {}
+            std::vector<Ptr> items;
+            size_type start;    //items[0] 的位置, 跟 starts 一致
+        };
+
+    public:
+        enum { block_size=512 };
+
+        struct locator {
+            const segment* seg;
+            size_type off;
+        };
+
+        segmented_index():count(0) {}
+
+        size_type size() const { return count; }
+        Ptr operator[](const size_type i) const { size_type k=block_of(i); return blocks[k]->items[i-starts[k]]; }
+        Ptr& operator[](const size_type i) { size_type k=block_of(i); return blocks[k]->items[i-starts[k]]; }
+        size_type position(const locator& l) const { return l.seg->start+l.off; }
+
+        range insert(const size_type i, const size_type n, const Ptr p) {
+            if (n==0) return range(i, i);
+            if (blocks.empty()) {
+                blocks.push_back(std::unique_ptr<segment>(new segment()));
+                starts.push_back(0);
+            }
+            size_type k= i==count ? blocks.size()-1 : block_of(i);
+            std::vector<Ptr>& b=blocks[k]->items;
+            b.insert(b.begin()+(i-starts[k]), n, p);
+            count+=n;
+            size_type first=i, last=starts[k]+b.size();
+            if (b.size()>block_size) {      //後半搬到新的 segment, 不管在不在 i 之前
+                first=std::min<size_type>(i, starts[k]+block_size/2);
+                split(k);
+            }
+            restart(k);
+            return range(first, last);
+        }
+
+        range erase(const size_type i, size_type j) {
+            if (i==j) return range(i, i);
+            size_type k=block_of(i), first=k;
+            count-=j-i;
+            for (size_type off=i-starts[k]; i<j; off=0) {
+                std::vector<Ptr>& b=blocks[k]->items;
+                size_type m=std::min(j-i, b.size()-off);
+                b.erase(b.begin()+off, b.begin()+off+m);
+                j-=m;
+                if (b.empty()) {
+                    blocks.erase(blocks.begin()+k);
+                    starts.erase(starts.begin()+k);
+                }
+                else ++k;
+            }
+            if (first>0) --first;      //前一塊可能可以跟後面合併
+            if (first+1<blocks.size() && blocks[first]->items.size()+blocks[first+1]->items.size()<=block_size/2) {
+                std::vector<Ptr>& b=blocks[first]->items;
+                b.insert(b.end(), blocks[first+1]->items.begin(), blocks[first+1]->items.end());
+                blocks.erase(blocks.begin()+first+1);
+                starts.erase(starts.begin()+first+1);
+            }
+            restart(first);
+            //i 所在的那塊, 被刪掉前段的那塊和併進來的那塊都在 first..first+2 裡
+            return range(first<blocks.size() ? starts[first] : count, first+3<blocks.size() ? starts[first+3] : count);
+        }
+
+        range reserve(size_type) { return range(0, 0); }
+        void clear() {
+            blocks.clear();
+            starts.clear();
+            count=0;
+        }
+        void swap(segmented_index& other) {
+            blocks.swap(other.blocks);
+            starts.swap(other.starts);
+            std::swap(count, other.count);
+        }
+
+        void locate(size_type i, const size_type j) {
+            if (i>=j) return;
+            for (size_type k=block_of(i), off=i-starts[k]; i<j; ++k, off=0) {
+                const std::vector<Ptr>& b=blocks[k]->items;
+                for (; off<b.size() && i<j; ++off, ++i) {
+                    b[off]->loc.seg=blocks[k].get();
+                    b[off]->loc.off=off;
+                }
+            }
+        }
+
+        template<typename Function>
+        void visit(size_type first, Function f) const {
+            if (first>=count) return;
+            for (size_type k=block_of(first), off=first-starts[k]; k<blocks.size(); ++k, off=0)
+                for (; off<blocks[k]->items.size(); ++off, ++first) f(blocks[k]->items[off], first);
+        }
+
+    private:
+        size_type block_of(const size_type i) const {
+            return std::upper_bound(starts.begin(), starts.end(), i)-starts.begin()-1;
+        }
+
+        void split(const size_type k) {
+            std::vector<Ptr>& b=blocks[k]->items;
+            std::vector<std::unique_ptr<segment> > parts;
+            for (size_type off=block_size/2; off<b.size(); off+=block_size/2) {
+                size_type end=std::min<size_type>(off+block_size/2, b.size());
+                parts.push_back(std::unique_ptr<segment>(new segment()));
+                parts.back()->items.assign(b.begin()+off, b.begin()+end);
+            }
+            b.resize(block_size/2);
+            blocks.insert(blocks.begin()+k+1, std::make_move_iterator(parts.begin()), std::make_move_iterator(parts.end()));
+            starts.insert(starts.begin()+k+1, parts.size(), 0);
+        }
+
+        void restart(size_type k) {
+            for (; k<blocks.size(); ++k) blocks[k]->start=starts[k]= k==0 ? 0 : starts[k-1]+blocks[k-1]->items.size();
+        }
+
+        std::vector<std::unique_ptr<segment> > blocks;     //segment 不搬動, locator 可以指著它
+        std::vector<size_type> starts;      //starts[k]: blocks[k] 第一個的位置
+        size_type count;
+};
+
+// Gap buffer: the free space sits where the last edit happened, so runs of
+// inserts or erases near one place move only the pointers between edits.
+// A locator is the slot in the buffer; the slots after the gap are read
+// relative to its end, so only the pointers the gap moved past need new
+// locators.
+template<typename Ptr>
+class gap_index {
+    public:
+        typedef size_type locator;
+
+        gap_index():gap(0), gap_end(0) {}
+
+        size_type size() const { return buf.size()-(gap_end-gap); }
+        Ptr operator[](const size_type i) const { return buf[slot(i)]; }
+        Ptr& operator[](const size_type i) { return buf[slot(i)]; }
+        size_type position(const locator l) const { return l<gap ? l : l-(gap_end-gap); }
+
+        range insert(const size_type i, const size_type n, const Ptr p) {
+            const size_type g=gap;
+            const bool grew=gap_end-gap<n;
+            if (grew) grow(n);      //gap 後面的全都換了位置
+            move_gap(i);
+            std::fill(buf.begin()+gap, buf.begin()+gap+n, p);
+            gap+=n;
+            return range(std::min(i, g), grew ? size() : std::max(i, g)+n);
+        }
+        range erase(const size_type i, const size_type j) {
+            const size_type g=gap;
+            move_gap(i);
+            gap_end+=j-i;
+            return range(std::min(i, g), std::min(std::max(i, g), size()));
+        }
+        range reserve(const size_type n) {
+            if (n<=size()) return range(0, 0);
+            grow(n-size());
+            return range(gap, size());
+        }
+        void clear() {
+            gap=0;
+            gap_end=buf.size();
+        }
+        void swap(gap_index& other) {
+            buf.swap(other.buf);
+            std::swap(gap, other.gap);
+            std::swap(gap_end, other.gap_end);
+        }
+
+        void locate(size_type i, const size_type j) {
+            for (; i<j; ++i) {
+                const size_type s=slot(i);
+                buf[s]->loc=s;
+            }
+        }
+
+        template<typename Function>
+        void visit(size_type first, Function f) const {
+            for (; first<gap; ++first) f(buf[first], first);
+            for (size_type p=first+(gap_end-gap); p<buf.size(); ++p,++first) f(buf[p], first);
+        }
+
+    private:
+        size_type slot(const size_type i) const { return i<gap ? i : i+(gap_end-gap); }
+
+        void move_gap(const size_type i) {
+            if (i<gap) std::copy_backward(buf.begin()+i, buf.begin()+gap, buf.begin()+gap_end);
+            else std::copy(buf.begin()+gap_end, buf.begin()+gap_end+(i-gap), buf.begin()+gap);
+            gap_end=gap_end+i-gap;
+            gap=i;
+        }
+
+        void grow(const size_type n) {
+            size_type live=size(), cap=std::max<size_type>(std::max<size_type>(2*buf.size(), live+n), 16);
+            std::vector<Ptr> w(cap);
+            std::copy(buf.begin(), buf.begin()+gap, w.begin());
+            std::copy(buf.begin()+gap_end, buf.end(), w.end()-(buf.size()-gap_end));
+            gap_end=cap-(buf.size()-gap_end);
+            buf.swap(w);
+        }
+
+        std::vector<Ptr> buf;   //buf[gap..gap_end) 是空的
+        size_type gap, gap_end;
+};
+
+// ---- node allocation: raw storage for one Node at a time ----
+
+// operator new / delete per node.
+template<typename Node>
+class individual_nodes {
+    public:
+        void* allocate() { return ::operator new(sizeof(Node)); }
+        void deallocate(void* const p) { ::operator delete(p); }
+        void swap(individual_nodes&) {}
+};
+
+// Individually allocated nodes, but freed ones are kept on a free list and
+// reused; everything is returned when the container goes away.
+template<typename Node>
+class pooled_nodes {
+    public:
+        pooled_nodes():free_list(nullptr) {}
+        pooled_nodes(const pooled_nodes&) = delete;
+        pooled_nodes& operator=(const pooled_nodes&) = delete;
+        ~pooled_nodes() {
+            while (free_list) {
+                free_node* f=free_list;
+                free_list=f->next;
+                ::operator delete(f);
+            }
+        }
+
+        void* allocate() {
+            if (!free_list) return ::operator new(sizeof(Node)<sizeof(free_node) ? sizeof(free_node) : sizeof(Node));
+            free_node* f=free_list;
+            free_list=f->next;
+            return f;
+        }
+        void deallocate(void* const p) { free_list=::new (p) free_node{free_list}; }
+        void swap(pooled_nodes& other) { std::swap(free_list, other.free_list); }
+
+    private:
+        struct free_node { free_node* next; };
+        free_node* free_list;
+};
+
+// Nodes carved out of slabs that double in size; freed nodes go on a free
+// list and the slabs are returned when the container goes away.
+template<typename Node>
+class slab_nodes {
+    public:
+        slab_nodes():free_list(nullptr), cur(nullptr), last(nullptr), total(0) {}
+        slab_nodes(const slab_nodes&) = delete;
+        slab_nodes& operator=(const slab_nodes&) = delete;
+        ~slab_nodes() { for (std::size_t k=0; k<slabs.size(); ++k) ::operator delete(slabs[k]); }
+
+        void* allocate() {
+            if (free_list) {
+                free_node* f=free_list;
+                free_list=f->next;
+                return f;
+            }
+            if (cur==last) {
+                size_type count=std::min<size_type>(std::max<size_type>(total, 16), size_type(1)<<16);
+                slabs.reserve(slabs.size()+1);
+                cur=static_cast<cell*>(::operator new(count*sizeof(cell)));
+                slabs.push_back(cur);
+                last=cur+count;
+                total+=count;
+            }
+            return cur++;
+        }
+        void deallocate(void* const p) { free_list=::new (p) free_node{free_list}; }
+        void swap(slab_nodes& other) {
+            slabs.swap(other.slabs);
+            std::swap(free_list, other.free_list);
+            std::swap(cur, other.cur);
+            std::swap(last, other.last);
+            std::swap(total, other.total);
+        }
+
+    private:
+        struct free_node { free_node* next; };
+        union cell {
+            typename std::aligned_storage<sizeof(Node), alignof(Node)>::type node;
+            free_node link;
+        };
+
+        std::vector<void*> slabs;
+        free_node* free_list;
+        cell* cur;
+        cell* last;
+        size_type total;
+};
+
+// ---- fix-up: when node locators are brought back in sync ----
+// Either way only the positions the index backend reported stale are
+// rewritten: everything after the edit for flat_index, the touched blocks
+// for segmented_index, the pointers the gap moved past for gap_index.
+
+// After every insert or erase, including insert_at and erase_at.
+struct eager_fixup { static const bool deferred=false; };
+// On the next operation that needs a position (iterator arithmetic,
+// index_of, iterator-based insert/erase); operator[], push_back and the
+// positional insert_at/erase_at never need one.
+struct deferred_fixup { static const bool deferred=true; };
+
+template<template<typename> class Index, template<typename> class NodeAllocation, typename Fixup>
+struct policy {
+    template<typename Ptr> using index_type = Index<Ptr>;
+    template<typename Node> using node_allocation = NodeAllocation<Node>;
+    typedef Fixup fixup;
+};
+
+typedef policy<flat_index, individual_nodes, eager_fixup> default_policy;
+
+}   // namespace sv_policy
+
+// stable_vector assembled from an index backend, a node allocation strategy
+// and a fix-up strategy (see sv_policy). Nodes store a locator from the
+// index backend (a position, or a block and an offset in it) rather than an
+// address, so the index may be laid out any way the backend likes. Iterators carry the container's heap block, like
+// slot_stable_vector, so they survive swap().
+template<typename T, typename Policy = sv_policy::default_policy>
+class policy_stable_vector {
+    private:
+        struct node;
+        struct block;
+
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Policy policy_type;
+
+        template<typename Value> class policy_iterator;
+        typedef policy_iterator<T> iterator;
+        typedef policy_iterator<const T> const_iterator;
+
+        policy_stable_vector():b(new block) {}
+
+        explicit policy_stable_vector(const size_type n, const T& value = T()):b(new block) {
+            insert_at(0, n, value);
+        }
+
+        template<typename InputIterator>
+        policy_stable_vector(InputIterator first, InputIterator last, typename std::enable_if<!std::is_integral<InputIterator>::value>::type* = nullptr):b(new block) {
+            try {
+                for (; first!=last; ++first) push_back(*first);
+            }
+            catch(...) {
+                clear();
+                throw;
+            }
+        }
+
+        policy_stable_vector(const policy_stable_vector& rhs):b(new block) {
+            try {
+                b->index.reserve(rhs.size());
+                for (const_iterator it=rhs.begin(); it!=rhs.end(); ++it) push_back(*it);
+            }
+            catch(...) {
+                clear();
+                throw;
+            }
+        }
+
+        policy_stable_vector& operator=(const policy_stable_vector& rhs) {
+            policy_stable_vector(rhs).swap(*this);
+            return *this;
+        }
+
+        ~policy_stable_vector() { clear(); }
+
+        reference at(const size_type pos) { return pos < size() ? (*this)[pos] : throw std::range_error("policy_stable_vector: out of range"); }
+        const_reference at(const size_type pos) const { return pos < size() ? (*this)[pos] : throw std::range_error("policy_stable_vector: out of range"); }
+
+        reference operator[](const size_type pos) { return b->index[pos]->datum; }
+        const_reference operator[](const size_type pos) const { return b->index[pos]->datum; }
+
+        reference front() { return (*this)[0]; }
+        const_reference front() const { return (*this)[0]; }
+
+        reference back() { return (*this)[size()-1]; }
+        const_reference back() const { return (*this)[size()-1]; }
+
+        iterator begin() { return iterator(b.get(), node_at(b.get(), 0)); }
+        const_iterator begin() const { return const_iterator(b.get(), node_at(b.get(), 0)); }
+        const_iterator cbegin() const { return begin(); }
+
+        iterator end() { return iterator(b.get(), nullptr); }
+        const_iterator end() const { return const_iterator(b.get(), nullptr); }
+        const_iterator cend() const { return end(); }
+
+        bool empty() const { return size()==0; }
+        size_type size() const { return b->index.size(); }
+
+        void reserve(const size_type n) { touched(b->index.reserve(n)); }
+
+        //O(1) (deferred: 先把位置補好)
+        size_type index_of(const_reference x) const {
+            fix(b.get());
+            return b->index.position(reinterpret_cast<const node*>(std::addressof(x))->loc);
+        }
+
+        void clear() {
+            b->index.visit(0, [this](node* const n, size_type) { destroy_node(n); });
+            b->index.clear();
+            b->dirty=sv_policy::range(0, 0);
+        }
+
+        void push_back(const T& value) { insert_at(size(), 1, value); }
+        void pop_back() { if (!empty()) erase_at(size()-1); }
+
+        iterator insert(const_iterator pos, const T& value) { return insert(pos, 1, value); }
+        iterator insert(const_iterator pos, const size_type n, const T& value) {
+            size_type p=position(b.get(), pos.n);
+            insert_at(p, n, value);
+            return begin()+p;
+        }
+
+        iterator erase(const_iterator pos) { return erase(pos, pos+1); }
+        iterator erase(const_iterator first, const_iterator last) {
+            size_type p1=position(b.get(), first.n), p2=position(b.get(), last.n);
+            erase_at(p1, p2);
+            return begin()+p1;
+        }
+
+        // Positional versions: with deferred_fixup a run of these writes no
+        // node at all until a position is needed again; with eager_fixup they
+        // rewrite the locators the backend reports stale, like insert/erase.
+        void insert_at(const size_type p, const size_type n, const T& value) {
+            size_type i=0;
+            const sv_policy::range r=b->index.insert(p, n, nullptr);
+            try {
+                for (; i<n; ++i) b->index[p+i]=make_node(value);
+            }
+            catch(...) {
+                const sv_policy::range e=b->index.erase(p+i, p+n);
+                inserted(p, i, sv_policy::range(std::min(r.first, e.first), size()));
+                throw;
+            }
+            inserted(p, n, r);
+        }
+        void insert_at(const size_type p, const T& value) { insert_at(p, 1, value); }
+
+        void erase_at(const size_type p1, const size_type p2) {
+            for (size_type f=p1; f!=p2; ++f) destroy_node(b->index[f]);
+            erased(p1, p2, b->index.erase(p1, p2));
+        }
+        void erase_at(const size_type p) { erase_at(p, p+1); }
+
+        void resize(const size_type count, const T& value = T()) {
+            if (count > size()) insert_at(size(), count-size(), value);
+            else if (count < size()) erase_at(count, size());
+        }
+
+        void swap(policy_stable_vector& other) { b.swap(other.b); }
+
+        friend bool operator==(const policy_stable_vector& lhs, const policy_stable_vector& rhs) {
+            return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+        }
+        friend bool operator!=(const policy_stable_vector& lhs, const policy_stable_vector& rhs) { return !(lhs == rhs); }
+        friend bool operator< (const policy_stable_vector& lhs, const policy_stable_vector& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+        }
+        friend bool operator<=(const policy_stable_vector& lhs, const policy_stable_vector& rhs) { return !(rhs < lhs); }
+        friend bool operator> (const policy_stable_vector& lhs, const policy_stable_vector& rhs) { return rhs < lhs; }
+        friend bool operator>=(const policy_stable_vector& lhs, const policy_stable_vector& rhs) { return !(lhs < rhs); }
+
+        template<typename Value>
+        class policy_iterator {
+            friend class policy_stable_vector;
+
+            public:
+                typedef policy_stable_vector::difference_type difference_type;
+                typedef typename std::remove_const<Value>::type value_type;
+                typedef Value* pointer;
+                typedef Value& reference;
+                typedef std::random_access_iterator_tag iterator_category;
+
+                policy_iterator():b(nullptr), n(nullptr) {}
+                policy_iterator(block* const b_, node* const n_):b(b_), n(n_) {}
+                policy_iterator(const policy_iterator<T>& rhs):b(rhs.b), n(rhs.n) {}
+
+                reference operator*() const { return n->datum; }
+                pointer operator->() const { return std::addressof(operator*()); }
+                reference operator[](const difference_type i) const { return *(*this+i); }
+
+                policy_iterator& operator+=(const difference_type i) { n=node_at(b, position(b, n)+i); return *this; }
+                policy_iterator& operator-=(const difference_type i) { return *this+=-i; }
+
+                friend policy_iterator operator+(policy_iterator it, const difference_type i) { return it+=i; }
+                friend policy_iterator operator+(const difference_type i, policy_iterator it) { return it+=i; }
+                friend policy_iterator operator-(policy_iterator it, const difference_type i) { return it-=i; }
+                friend difference_type operator-(const policy_iterator lhs, const policy_iterator rhs) { return lhs.distance_from(rhs); }
+
+                policy_iterator& operator++() { return *this+=1; }
+                policy_iterator operator++(int) {
+                    policy_iterator it(*this);
+                    ++*this;
+                    return it;
+                }
+
+                policy_iterator& operator--() { return *this-=1; }
+                policy_iterator operator--(int) {
+                    policy_iterator it(*this);
+                    --*this;
+                    return it;
+                }
+
+                friend bool operator==(const policy_iterator lhs, const policy_iterator rhs) { return lhs.n==rhs.n; }
+                friend bool operator!=(const policy_iterator lhs, const policy_iterator rhs) { return !(lhs==rhs); }
+                friend bool operator< (const policy_iterator lhs, const policy_iterator rhs) { return (lhs-rhs)<0; }
+                friend bool operator<=(const policy_iterator lhs, const policy_iterator rhs) { return !(rhs<lhs); }
+                friend bool operator> (const policy_iterator lhs, const policy_iterator rhs) { return rhs<lhs; }
+                friend bool operator>=(const policy_iterator lhs, const policy_iterator rhs) { return !(lhs<rhs); }
+
+            private:
+                difference_type distance_from(const policy_iterator rhs) const {
+                    return static_cast<difference_type>(position(b, n))-static_cast<difference_type>(position(b, rhs.n));
+                }
+
+                block* b;
+                node* n;
+
+                template<typename> friend class policy_iterator;
+        };
+
+    private:
+        typedef typename Policy::template index_type<node*> index_type;
+        typedef typename Policy::template node_allocation<node> allocation_type;
+        typedef typename Policy::fixup fixup_type;
+
+        struct node {
+            explicit node(const T& value):datum(value), loc() {}
+            T datum;        //datum 放第一個, index_of 才能從元素找回 node
+            typename index_type::locator loc;
+        };
+
+        struct block {
+            block():dirty(0, 0) {}
+            index_type index;
+            allocation_type alloc;
+            sv_policy::range dirty;     //deferred: 這些位置的 loc 可能過期
+        };
+
+        std::unique_ptr<block> b;
+
+        static node* node_at(block* const b, const size_type i) { return i==b->index.size() ? nullptr : b->index[i]; }
+
+        static size_type position(block* const b, const node* const n) {
+            if (!n) return b->index.size();
+            fix(b);
+            return b->index.position(n->loc);
+        }
+
+        static void fix(block* const b) {
+            if (!fixup_type::deferred || b->dirty.first>=b->dirty.second) return;
+            b->index.locate(b->dirty.first, std::min(b->dirty.second, b->index.size()));
+            b->dirty=sv_policy::range(0, 0);
+        }
+
+        //deferred: 還沒補的範圍跟著插入/刪除移動 (只會變大, 不會漏掉)
+        void inserted(const size_type p, const size_type n, const sv_policy::range r) {
+            if (fixup_type::deferred && b->dirty.second>p) b->dirty.second+=n;
+            touched(r);
+        }
+        void erased(const size_type p1, const size_type p2, const sv_policy::range r) {
+            sv_policy::range& d=b->dirty;
+            if (fixup_type::deferred && d.second>p1) {
+                d.second= d.second>=p2 ? d.second-(p2-p1) : p1;
+                d.first=std::min(d.first, p1);
+            }
+            touched(r);
+        }
+
+        void touched(const sv_policy::range r) {
+            if (r.first>=r.second) return;
+            if (!fixup_type::deferred) b->index.locate(r.first, r.second);
+            else if (b->dirty.first>=b->dirty.second) b->dirty=r;
+            else b->dirty=sv_policy::range(std::min(b->dirty.first, r.first), std::max(b->dirty.second, r.second));
+        }
+
+        node* make_node(const T& value) {
+            void* m=b->alloc.allocate();
+            try { return ::new (m) node(value); }
+            catch(...) { b->alloc.deallocate(m); throw; }
+        }
+
+        void destroy_node(node* const n) {
+            n->~node();
+            b->alloc.deallocate(n);
+        }
+};
+
+#endif
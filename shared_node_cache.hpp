@@ -0,0 +1,228 @@
+#ifndef SHARED_NODE_CACHE_HPP
+#define SHARED_NODE_CACHE_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Process-wide cache of small blocks for containers that allocate one node
+// at a time. Requests are rounded up to a size class (multiples of 16 bytes,
+// up to 256). Each thread keeps a free list per class, so allocating and
+// freeing a node normally touches no lock. A thread that runs dry takes a
+// batch of blocks from the central depot, and a thread whose list grows past
+// two batches hands one back, so blocks freed on one thread are reused by
+// others. Memory comes from the system in chunks of one batch and is kept
+// for the life of the process.
+//
+// A thread whose own cache is already destroyed (a thread_local destroyed
+// after it, say) works on the depot directly. Its frees collect in a loose
+// list per class there and go into the depot as one batch once they make
+// a full one, so the depot does not fill up with one-block batches.
+class shared_node_cache {
+    public:
+        enum { granule=16, max_block=256, classes=max_block/granule, batch=64 };
+
+        struct stats {
+            std::size_t reserved_bytes;     //chunks taken from the system
+            std::size_t depot_blocks;       //free blocks waiting in the depot
+            std::size_t depot_batches;      //batches they are grouped in, loose lists not counted
+        };
+
+        // bytes must be at most max_block.
+        static void* allocate(const std::size_t bytes) {
+            const std::size_t k=size_class(bytes);
+            if (retired()) return allocate_retired(k);
+            free_list& l=local().lists[k];
+            if (!l.head) refill(l, k);
+            block* b=l.head;
+            l.head=b->next;
+            --l.count;
+            return b;
+        }
+
+        static void deallocate(void* const p, const std::size_t bytes) {
+            const std::size_t k=size_class(bytes);
+            if (retired()) return deallocate_retired(p, k);
+            free_list& l=local().lists[k];
+            l.head=::new (p) block{l.head};
+            if (++l.count>=2*batch) give_back(l, k, batch);
+        }
+
+        static stats statistics() {
+            depot& d=central();
+            std::lock_guard<std::mutex> lock(d.lock);
+            stats s={d.reserved, 0, 0};
+            for (std::size_t k=0; k<classes; ++k) {
+                for (std::size_t i=0; i<d.batches[k].size(); ++i) s.depot_blocks+=d.batches[k][i].count;
+                s.depot_blocks+=d.loose[k].count;
+                s.depot_batches+=d.batches[k].size();
+            }
+            return s;
+        }
+
+    private:
+        struct block { block* next; };
+
+        struct free_list {
+            block* head;
+            std::size_t count;
+        };
+
+        struct depot {
+            depot():reserved(0) {
+                for (std::size_t k=0; k<classes; ++k) loose[k]=free_list{nullptr, 0};
+            }
+            std::mutex lock;
+            std::vector<free_list> batches[classes];
+            free_list loose[classes];       //retired threads 的 block, 湊滿一批才進 batches
+            std::size_t reserved;
+        };
+
+        // 執行緒結束時把手上的 block 全部還給 depot
+        struct local_cache {
+            local_cache() {
+                for (std::size_t k=0; k<classes; ++k) lists[k]=free_list{nullptr, 0};
+            }
+            ~local_cache() {
+                for (std::size_t k=0; k<classes; ++k)
+                    if (lists[k].count) give_back(lists[k], k, lists[k].count);
+                retired()=true;
+            }
+            free_list lists[classes];
+        };
+
+        static std::size_t size_class(const std::size_t bytes) { return bytes ? (bytes-1)/granule : 0; }
+
+        //不會解構: 別的 thread 結束時可能還要用到它
+        static depot& central() {
+            static depot* const d=new depot;
+            return *d;
+        }
+
+        static local_cache& local() {
+            thread_local local_cache c;
+            return c;
+        }
+
+        //這個 thread 的 local_cache 已經解構 (例如 static 物件在 thread_local 之後才解構): 直接用 depot
+        static bool& retired() {
+            thread_local bool r=false;
+            return r;
+        }
+
+        static void* allocate_retired(const std::size_t k) {
+            depot& d=central();
+            {
+                std::lock_guard<std::mutex> lock(d.lock);
+                free_list& s=d.loose[k];
+                if (s.head) {
+                    block* b=s.head;
+                    s.head=b->next;
+                    --s.count;
+                    return b;
+                }
+            }
+            free_list l={nullptr, 0};
+            refill(l, k);
+            block* b=l.head;
+            l.head=b->next;
+            if (--l.count) {
+                std::lock_guard<std::mutex> lock(d.lock);
+                if (!d.loose[k].head) d.loose[k]=l;    //剩下的留給之後的 retired 呼叫
+                else d.batches[k].push_back(l);
+            }
+            return b;
+        }
+
+        static void deallocate_retired(void* const p, const std::size_t k) {
+            depot& d=central();
+            std::lock_guard<std::mutex> lock(d.lock);
+            free_list& s=d.loose[k];
+            s.head=::new (p) block{s.head};
+            if (++s.count>=batch) {
+                d.batches[k].push_back(s);
+                s=free_list{nullptr, 0};
+            }
+        }
+
+        static void refill(free_list& l, const std::size_t k) {
+            depot& d=central();
+            {
+                std::lock_guard<std::mutex> lock(d.lock);
+                if (!d.batches[k].empty()) {
+                    l=d.batches[k].back();
+                    d.batches[k].pop_back();
+                    return;
+                }
+            }
+            char* const mem=static_cast<char*>(::operator new(batch*(k+1)*granule));
+            {
+                std::lock_guard<std::mutex> lock(d.lock);
+                d.reserved+=batch*(k+1)*granule;
+            }
+            block* head=nullptr;
+            for (std::size_t i=batch; i-->0; ) head=::new (mem+i*(k+1)*granule) block{head};
+            l=free_list{head, batch};
+        }
+
+        //l 最前面的 n 個 block 成為 depot 的一批
+        static void give_back(free_list& l, const std::size_t k, const std::size_t n) {
+            free_list out={l.head, n};
+            block* last=l.head;
+            for (std::size_t i=1; i<n; ++i) last=last->next;
+            l.head=last->next;
+            l.count-=n;
+            last->next=nullptr;
+            depot& d=central();
+            std::lock_guard<std::mutex> lock(d.lock);
+            d.batches[k].push_back(out);
+        }
+};
+
+// Allocator over shared_node_cache. Single objects small enough for a size
+// class come from the cache; anything else goes to operator new. All
+// instances are interchangeable. It defines caches_single_nodes, so
+// stable_vector asks it for every node instead of keeping slabs of its own:
+// an empty or tiny container then holds no spare nodes.
+template<typename T>
+class shared_node_allocator {
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef std::true_type caches_single_nodes;
+        typedef std::true_type is_always_equal;
+
+        template<typename U>
+        struct rebind { typedef shared_node_allocator<U> other; };
+
+        shared_node_allocator() {}
+        template<typename U>
+        shared_node_allocator(const shared_node_allocator<U>&) {}
+
+        T* allocate(const size_type n) {
+            if (cached(n)) return static_cast<T*>(shared_node_cache::allocate(sizeof(T)));
+            return static_cast<T*>(::operator new(n*sizeof(T)));
+        }
+
+        void deallocate(T* const p, const size_type n) {
+            if (cached(n)) shared_node_cache::deallocate(p, sizeof(T));
+            else ::operator delete(p);
+        }
+
+        template<typename U>
+        bool operator==(const shared_node_allocator<U>&) const { return true; }
+        template<typename U>
+        bool operator!=(const shared_node_allocator<U>&) const { return false; }
+
+    private:
+        static bool cached(const size_type n) {
+            return n==1 && sizeof(T)<=shared_node_cache::max_block && alignof(T)<=alignof(std::max_align_t);
+        }
+};
+
+#endif
@@ -0,0 +1,466 @@
+#ifndef SLOT_STABLE_VECTOR_HPP
+#define SLOT_STABLE_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// stable_vector variant whose nodes store their slot number instead of an
+// address into the index. Iterators carry the index block, so growing,
+// reserving or shrinking the index is a plain copy of pointers and never
+// touches the nodes. Inserting or erasing in the middle still renumbers the
+// nodes after the position.
+//
+// With incremental_growth(true) the larger index is allocated once the
+// current one is half full and each push_back or insert copies a few more
+// slots into it, so no single call pays for copying the whole index. Inserts
+// and erases are applied to the copied part as well, so they never undo the
+// migration. Large index buffers are mmap'd by the container (on Linux), and
+// a retired one is unmapped a batch of pages at a time.
+template<typename T>
+class slot_stable_vector {
+    private:
+        struct node_base;
+        struct node;
+        struct index_block;
+
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        template<typename Value> class slot_iterator;
+        typedef slot_iterator<T> iterator;
+        typedef slot_iterator<const T> const_iterator;
+
+        slot_stable_vector():b(new index_block) {}
+
+        explicit slot_stable_vector(const size_type n, const T& value = T()):b(new index_block) {
+            insert(cend(), n, value);
+        }
+
+        template<typename InputIterator>
+        slot_stable_vector(InputIterator first, InputIterator last, typename std::enable_if<!std::is_integral<InputIterator>::value>::type* = nullptr):b(new index_block) {
+            for (; first!=last; ++first) push_back(*first);
+        }
+
+        slot_stable_vector(const slot_stable_vector& rhs):b(new index_block) {
+            reserve(rhs.size());
+            for (const_iterator it=rhs.begin(); it!=rhs.end(); ++it) push_back(*it);
+        }
+
+        slot_stable_vector& operator=(const slot_stable_vector& rhs) {
+            slot_stable_vector(rhs).swap(*this);
+            return *this;
+        }
+
+        ~slot_stable_vector() { clear(); }
+
+        reference at(const size_type pos) { return pos < size() ? (*this)[pos] : throw std::range_error("slot_stable_vector: out of range"); }
+        const_reference at(const size_type pos) const { return pos < size() ? (*this)[pos] : throw std::range_error("slot_stable_vector: out of range"); }
+
+        reference operator[](const size_type pos) { return value(b->v[pos]); }
+        const_reference operator[](const size_type pos) const { return value(b->v[pos]); }
+
+        reference front() { return value(b->v.front()); }
+        const_reference front() const { return value(b->v.front()); }
+
+        reference back() { return value(*(b->v.end()-2)); }
+        const_reference back() const { return value(*(b->v.end()-2)); }
+
+        iterator begin() { return iterator(b.get(), b->v.front()); }
+        const_iterator begin() const { return const_iterator(b.get(), b->v.front()); }
+        const_iterator cbegin() const { return begin(); }
+
+        iterator end() { return iterator(b.get(), &b->end_node); }
+        const_iterator end() const { return const_iterator(b.get(), &b->end_node); }
+        const_iterator cend() const { return end(); }
+
+        bool empty() const { return b->v.size()==1; }
+        size_type size() const { return b->v.size()-1; }
+        size_type capacity() const { return b->v.capacity()-1; }
+
+        // No node is written: slots do not depend on where the index lives.
+        void reserve(const size_type n) { stop_migration(); b->v.reserve(n+1); }
+        void shrink_to_fit() { stop_migration(); b->v.shrink_to_fit(); }
+
+        bool incremental_growth() const { return b->incremental; }
+        void incremental_growth(const bool on) {
+            if (!on) {
+                stop_migration();
+                b->retired.deallocate();
+            }
+            b->incremental=on;
+        }
+
+        void clear() { erase(cbegin(), cend()); }
+
+        void push_back(const T& value) {
+            node* n=new node(value, size());
+            try {
+                if (b->incremental) migrate_step(1);
+                b->v.insert(b->v.end()-1, n);
+            }
+            catch(...) { delete n; throw; }
+            ++b->end_node.slot;
+        }
+        void pop_back() { if (!empty()) erase(cend()-1); }
+
+        iterator insert(const_iterator pos, const T& value) { return insert(pos, 1, value); }
+        iterator insert(const_iterator pos, const size_type n, const T& value) {
+            size_type p=pos.n->slot, i=0;
+            if (b->incremental) migrate_step(n);
+            b->v.insert(b->v.begin()+p, n, nullptr);
+            try {
+                for (; i<n; ++i) b->v[p+i]=new node(value, p+i);
+            }
+            catch(...) {
+                b->v.erase(b->v.begin()+p+i, b->v.begin()+p+n);
+                mirror_insert(p, i);
+                renumber(p+i);
+                throw;
+            }
+            mirror_insert(p, n);
+            renumber(p+n);
+            return begin()+p;
+        }
+
+        iterator erase(const_iterator pos) { return erase(pos, pos+1); }
+        iterator erase(const_iterator first, const_iterator last) {
+            size_type p1=first.n->slot, p2=last.n->slot;
+            for (size_type f=p1; f!=p2; ++f) delete static_cast<node*>(b->v[f]);
+            b->v.erase(b->v.begin()+p1, b->v.begin()+p2);
+            mirror_erase(p1, p2);
+            renumber(p1);
+            return begin()+p1;
+        }
+
+        void resize(const size_type count, const T& value = T()) {
+            if (count > size()) insert(cend(), count-size(), value);
+            else if (count < size()) erase(cbegin()+count, cend());
+        }
+
+        void swap(slot_stable_vector& other) { b.swap(other.b); }
+
+        friend bool operator==(const slot_stable_vector& lhs, const slot_stable_vector& rhs) {
+            return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+        }
+        friend bool operator!=(const slot_stable_vector& lhs, const slot_stable_vector& rhs) { return !(lhs == rhs); }
+        friend bool operator< (const slot_stable_vector& lhs, const slot_stable_vector& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+        }
+        friend bool operator<=(const slot_stable_vector& lhs, const slot_stable_vector& rhs) { return !(rhs < lhs); }
+        friend bool operator> (const slot_stable_vector& lhs, const slot_stable_vector& rhs) { return rhs < lhs; }
+        friend bool operator>=(const slot_stable_vector& lhs, const slot_stable_vector& rhs) { return !(lhs < rhs); }
+
+        template<typename Value>
+        class slot_iterator {
+            friend class slot_stable_vector;
+
+            public:
+                typedef slot_stable_vector::difference_type difference_type;
+                typedef typename std::remove_const<Value>::type value_type;
+                typedef Value* pointer;
+                typedef Value& reference;
+                typedef std::random_access_iterator_tag iterator_category;
+
+                slot_iterator():b(nullptr), n(nullptr) {}
+                slot_iterator(const index_block* const b_, node_base* const n_):b(b_), n(n_) {}
+                slot_iterator(const slot_iterator<T>& rhs):b(rhs.b), n(rhs.n) {}
+
+                reference operator*() const { return value(n); }
+                pointer operator->() const { return std::addressof(operator*()); }
+                reference operator[](const difference_type i) const { return value(b->v[n->slot+i]); }
+
+                slot_iterator& operator+=(const difference_type i) { n=b->v[n->slot+i]; return *this; }
+                slot_iterator& operator-=(const difference_type i) { return *this+=-i; }
+
+                friend slot_iterator operator+(slot_iterator it, const difference_type i) { return it+=i; }
+                friend slot_iterator operator+(const difference_type i, slot_iterator it) { return it+=i; }
+                friend slot_iterator operator-(slot_iterator it, const difference_type i) { return it-=i; }
+                friend difference_type operator-(const slot_iterator lhs, const slot_iterator rhs) {
+                    return static_cast<difference_type>(lhs.n->slot)-static_cast<difference_type>(rhs.n->slot);
+                }
+
+                slot_iterator& operator++() { n=b->v[n->slot+1]; return *this; }
+                slot_iterator operator++(int) {
+                    slot_iterator it(*this);
+                    ++*this;
+                    return it;
+                }
+
+                slot_iterator& operator--() { n=b->v[n->slot-1]; return *this; }
+                slot_iterator operator--(int) {
+                    slot_iterator it(*this);
+                    --*this;
+                    return it;
+                }
+
+                friend bool operator==(const slot_iterator lhs, const slot_iterator rhs) { return lhs.n==rhs.n; }
+                friend bool operator!=(const slot_iterator lhs, const slot_iterator rhs) { return !(lhs==rhs); }
+                friend bool operator< (const slot_iterator lhs, const slot_iterator rhs) { return lhs.n->slot<rhs.n->slot; }
+                friend bool operator<=(const slot_iterator lhs, const slot_iterator rhs) { return !(rhs<lhs); }
+                friend bool operator> (const slot_iterator lhs, const slot_iterator rhs) { return rhs<lhs; }
+                friend bool operator>=(const slot_iterator lhs, const slot_iterator rhs) { return !(lhs<rhs); }
+
+            private:
+                const index_block* b;
+                node_base* n;
+
+                template<typename> friend class slot_iterator;
+        };
+
+    private:
+        struct node_base {
+            explicit node_base(const size_type s = 0):slot(s) {}
+            size_type slot;
+        };
+
+        struct node : node_base {
+            node(const T& value, const size_type s):node_base(s), datum(value) {}
+            T datum;
+        };
+
+        static const size_type slots_per_push=4;
+        static const std::size_t map_bytes=1<<20;          //至少這麼大的 index 自己 mmap
+        static const std::size_t page_batch=128<<10;       //每次 munmap / 預先 fault 多少, page 的倍數
+        static const size_type pushes_per_batch=256;
+
+        // Index storage: an array of node pointers moved with memmove. Buffers
+        // of at least map_bytes come from mmap on Linux, so the container may
+        // fault their pages in and unmap a retired one in batches; the rest
+        // come from operator new.
+        class index_buffer {
+            public:
+                typedef node_base** iterator;
+                typedef node_base* const* const_iterator;
+
+                index_buffer():first(nullptr), count(0), cap(0), mapped(0), unmapped(0), populated(0) {}
+                index_buffer(const index_buffer&) = delete;
+                index_buffer& operator=(const index_buffer&) = delete;
+                ~index_buffer() { release(); }
+
+                iterator begin() { return first; }
+                const_iterator begin() const { return first; }
+                iterator end() { return first+count; }
+                const_iterator end() const { return first+count; }
+
+                size_type size() const { return count; }
+                size_type capacity() const { return cap; }
+
+                node_base*& operator[](const size_type i) { return first[i]; }
+                node_base* operator[](const size_type i) const { return first[i]; }
+                node_base* front() const { return first[0]; }
+
+                void reserve(const size_type n) { if (n>cap) reallocate(n); }
+                void shrink_to_fit() { if (cap>count) reallocate(count); }
+
+                void push_back(node_base* const x) {
+                    if (count==cap) reallocate(std::max<size_type>(2*cap, count+1));
+                    first[count++]=x;
+                }
+
+                iterator insert(const_iterator pos, node_base* const x) { return insert(pos, 1, x); }
+                iterator insert(const_iterator pos, const size_type n, node_base* const x) {
+                    const size_type i=pos-first;
+                    if (count+n>cap) reallocate(std::max<size_type>(2*cap, count+n));
+                    std::memmove(first+i+n, first+i, (count-i)*sizeof(node_base*));
+                    std::fill(first+i, first+i+n, x);
+                    count+=n;
+                    return first+i;
+                }
+
+                iterator erase(const_iterator a, const_iterator b) {
+                    const size_type i=a-first, n=b-a;
+                    std::memmove(first+i, first+i+n, (count-i-n)*sizeof(node_base*));
+                    count-=n;
+                    return first+i;
+                }
+
+                void swap(index_buffer& other) {
+                    std::swap(first, other.first);
+                    std::swap(count, other.count);
+                    std::swap(cap, other.cap);
+                    std::swap(mapped, other.mapped);
+                    std::swap(unmapped, other.unmapped);
+                    std::swap(populated, other.populated);
+                }
+
+                void deallocate() {
+                    index_buffer().swap(*this);
+                }
+
+                // For a buffer that is no longer read: unmaps up to `bytes' more
+                // of it from the front. Buffers not from mmap go all at once.
+                void release_front(const std::size_t bytes) {
+#if defined(__linux__)
+                    if (mapped-unmapped>bytes) {
+                        munmap(reinterpret_cast<char*>(first)+unmapped, bytes);
+                        unmapped+=bytes;
+                        return;
+                    }
+#endif
+                    deallocate();
+                }
+
+                // Faults in the pages of a mmap'd buffer up to `bytes' past its
+                // end in one go, once fewer than half of those are left, so the
+                // slots written next do not fault a page at a time.
+                void prefault(const std::size_t bytes) {
+#if defined(__linux__)
+                    const std::size_t used=count*sizeof(node_base*);
+                    if (populated>=std::min(mapped, used+bytes/2)) return;
+                    const std::size_t last=std::min(mapped, (used+bytes+page_size()-1)/page_size()*page_size());
+                    char* const p=reinterpret_cast<char*>(first);
+#if defined(MADV_POPULATE_WRITE)
+                    if (madvise(p+populated, last-populated, MADV_POPULATE_WRITE)==0) {
+                        populated=last;
+                        return;
+                    }
+#endif
+                    for (; populated<last; populated+=page_size()) {   //舊 kernel: 自己每頁碰一下
+                        volatile char* const q=p+populated;
+                        *q=*q;
+                    }
+#else
+                    (void)bytes;
+#endif
+                }
+
+            private:
+#if defined(__linux__)
+                static std::size_t page_size() {
+                    static const std::size_t page=static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+                    return page;
+                }
+#endif
+
+                void reallocate(const size_type n) {
+                    index_buffer w;
+                    w.allocate(n);
+                    if (count) std::memcpy(w.first, first, count*sizeof(node_base*));
+                    w.count=count;
+                    swap(w);
+                }
+
+                void allocate(const size_type n) {
+#if defined(__linux__)
+                    if (n*sizeof(node_base*)>=map_bytes) {
+                        const std::size_t len=(n*sizeof(node_base*)+page_size()-1)/page_size()*page_size();
+                        void* const p=mmap(nullptr, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+                        if (p==MAP_FAILED) throw std::bad_alloc();
+                        first=static_cast<node_base**>(p);
+                        cap=len/sizeof(node_base*);
+                        mapped=len;
+                        return;
+                    }
+#endif
+                    first=static_cast<node_base**>(::operator new(n*sizeof(node_base*)));
+                    cap=n;
+                }
+
+                void release() {
+#if defined(__linux__)
+                    if (mapped) {
+                        munmap(reinterpret_cast<char*>(first)+unmapped, mapped-unmapped);
+                        return;
+                    }
+#endif
+                    ::operator delete(first);
+                }
+
+                node_base** first;
+                size_type count, cap;
+                std::size_t mapped, unmapped;   //mmap 的長度和前面已經 munmap 的部分
+                std::size_t populated;          //前面已經 fault 進來的部分
+        };
+
+        // Heap block so that swap() keeps iterators (including end()) attached
+        // to their elements.
+        struct index_block {
+            index_block():pushes(0), incremental(false) { v.push_back(&end_node); }
+            index_buffer v;         //v.back() 是 end_node
+            index_buffer next;      //incremental growth: v[0..next.size()) 已複製
+            index_buffer retired;   //換下來的舊 index, 逐步釋放
+            size_type pushes;
+            node_base end_node;
+            bool incremental;
+        };
+
+        std::unique_ptr<index_block> b;
+
+        static T& value(node_base* const n) { return static_cast<node*>(n)->datum; }
+
+        // Runs before v grows by n slots. v stays authoritative while next is
+        // being filled, so lookups never look at next; next is switched in
+        // when v has no room for the n new slots. If next is too small for
+        // them as well, the migration is dropped and v grows on its own.
+        void migrate_step(const size_type n) {
+            index_buffer& v=b->v;
+            index_buffer& next=b->next;
+            page_step();
+            if (next.capacity()==0) {
+                if (2*v.size()<v.capacity()) return;
+                next.reserve(2*v.capacity());
+            }
+            for (size_type k=0; k<slots_per_push && next.size()+1<v.size(); ++k)
+                next.push_back(v[next.size()]);
+            if (v.size()+n>v.capacity()) {
+                if (next.capacity()>=v.size()+n) {
+                    while (next.size()<v.size()) next.push_back(v[next.size()]);
+                    v.swap(next);
+                    b->retired.deallocate();    //上一個還沒放完就一次放掉
+                    b->retired.swap(next);
+                }
+                stop_migration();
+            }
+        }
+
+        // Page work is kept off the common path. Unmapping the retired index in
+        // one go stalls as long as the copy we avoided, and a page fault or a
+        // munmap every few hundred push_backs lands in p99. So once every
+        // pushes_per_batch calls the retired index gives back page_batch bytes
+        // and the pages just past the ends of v and next are faulted in.
+        void page_step() {
+            if (++b->pushes<pushes_per_batch) return;
+            b->pushes=0;
+            if (b->retired.capacity()!=0) b->retired.release_front(page_batch);
+            b->v.prefault(page_batch);
+            b->next.prefault(page_batch);
+        }
+
+        // Apply an insert or erase in v to the part of next already copied.
+        // next has room: it is twice as large as v, which has not grown.
+        void mirror_insert(const size_type p, const size_type n) {
+            index_buffer& next=b->next;
+            if (p<next.size()) std::copy(b->v.begin()+p, b->v.begin()+p+n, next.insert(next.begin()+p, n, nullptr));
+        }
+        void mirror_erase(const size_type p1, const size_type p2) {
+            index_buffer& next=b->next;
+            if (p1<next.size()) next.erase(next.begin()+p1, next.begin()+std::min(p2, next.size()));
+        }
+
+        void stop_migration() { b->next.deallocate(); }
+
+        void renumber(size_type first) {
+            for (; first!=b->v.size(); ++first) b->v[first]->slot=first;
+        }
+};
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef SORTED_STABLE_VECTOR_HPP
+#define SORTED_STABLE_VECTOR_HPP
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "stable_vector.hpp"
+
+// Sorted sequence on top of stable_vector. Lookups use stable_vector's
+// branchless lower_bound/upper_bound over the node index, and every element
+// keeps its address until it is erased. With Unique == true it behaves as a
+// set; stable_flat_set is that instantiation.
+//
+// For read-mostly use, build_search_shadow() copies the keys into an
+// Eytzinger (breadth-first) array, so the first levels of every search hit
+// the same few cache lines and no node is loaded. Any insert or erase drops
+// the shadow; lookups then fall back to the node index until it is rebuilt.
+template<typename T, typename Compare = std::less<T>, bool Unique = false>
+class sorted_stable_vector {
+    private:
+        typedef stable_vector<T> base_type;
+
+    public:
+        typedef T value_type;
+        typedef T key_type;
+        typedef Compare key_compare;
+        typedef typename base_type::const_reference reference;
+        typedef typename base_type::const_reference const_reference;
+        typedef typename base_type::size_type size_type;
+        typedef typename base_type::difference_type difference_type;
+        typedef typename base_type::const_iterator iterator;
+        typedef typename base_type::const_iterator const_iterator;
+
+        explicit sorted_stable_vector(const Compare& c = Compare()):comp(c) {}
+
+        template<typename InputIterator>
+        sorted_stable_vector(InputIterator first, InputIterator last, const Compare& c = Compare()):comp(c) {
+            for (; first!=last; ++first) insert(*first);
+        }
+
+        const_iterator begin() const { return v.cbegin(); }
+        const_iterator end() const { return v.cend(); }
+        const_iterator cbegin() const { return v.cbegin(); }
+        const_iterator cend() const { return v.cend(); }
+
+        const_reference operator[](const size_type pos) const { return v[pos]; }
+        const_reference at(const size_type pos) const { return v.at(pos); }
+        const_reference front() const { return v.front(); }
+        const_reference back() const { return v.back(); }
+
+        bool empty() const { return v.empty(); }
+        size_type size() const { return v.size(); }
+        key_compare key_comp() const { return comp; }
+
+        // O(1) through the node's back-pointer.
+        size_type index_of(const_reference x) const { return v.index_of(x); }
+
+        // Equal elements are kept in insertion order. For a set, returns the
+        // existing element and false when key is already present.
+        std::pair<iterator, bool> insert(const T& key) {
+            size_type pos=upper_bound_pos(key);
+            if (Unique && pos!=0 && !comp(v[pos-1], key)) return std::make_pair(v.cbegin()+(pos-1), false);
+            drop_search_shadow();
+            return std::make_pair(iterator(v.insert(v.cbegin()+pos, key)), true);
+        }
+
+        const_iterator lower_bound(const T& key) const { return v.cbegin()+lower_bound_pos(key); }
+        const_iterator upper_bound(const T& key) const { return v.cbegin()+upper_bound_pos(key); }
+        std::pair<const_iterator, const_iterator> equal_range(const T& key) const {
+            return std::make_pair(lower_bound(key), upper_bound(key));
+        }
+
+        const_iterator find(const T& key) const {
+            size_type pos=lower_bound_pos(key);
+            return pos!=size() && !comp(key, v[pos]) ? v.cbegin()+pos : v.cend();
+        }
+        size_type count(const T& key) const { return upper_bound_pos(key)-lower_bound_pos(key); }
+        bool contains(const T& key) const {
+            if (!has_search_shadow()) return v.binary_search(key, comp);
+            size_type k=shadow_slot([&](const T& x) { return comp(x, key); });    //只看 shadow, 不碰節點
+            return k!=0 && !comp(key, shadow_keys[k-1]);
+        }
+
+        iterator erase(const_iterator pos) { drop_search_shadow(); return v.erase(pos); }
+        iterator erase(const_iterator first, const_iterator last) { drop_search_shadow(); return v.erase(first, last); }
+        size_type erase(const T& key) {
+            size_type first=lower_bound_pos(key), last=upper_bound_pos(key);
+            if (first!=last) {
+                drop_search_shadow();
+                v.erase(v.cbegin()+first, v.cbegin()+last);
+            }
+            return last-first;
+        }
+
+        void clear() { drop_search_shadow(); v.clear(); }
+        void swap(sorted_stable_vector& other) {
+            v.swap(other.v);
+            std::swap(comp, other.comp);
+            shadow_keys.swap(other.shadow_keys);
+            shadow_rank.swap(other.shadow_rank);
+        }
+
+        // Copies the keys in Eytzinger order: slot k's children are 2k+1
+        // and 2k+2. O(n) time, n extra keys and positions.
+        void build_search_shadow() {
+            std::vector<size_type> rank(size());
+            size_type next=0;
+            shadow_fill(rank, 0, next);
+            std::vector<T> keys;
+            keys.reserve(rank.size());
+            for (size_type k=0; k<rank.size(); ++k) keys.push_back(v[rank[k]]);
+            shadow_keys.swap(keys);
+            shadow_rank.swap(rank);
+        }
+        void drop_search_shadow() {
+            shadow_keys.clear();
+            shadow_rank.clear();
+        }
+        bool has_search_shadow() const { return !shadow_keys.empty(); }
+
+        friend bool operator==(const sorted_stable_vector& lhs, const sorted_stable_vector& rhs) { return lhs.v==rhs.v; }
+        friend bool operator!=(const sorted_stable_vector& lhs, const sorted_stable_vector& rhs) { return lhs.v!=rhs.v; }
+
+    private:
+        size_type lower_bound_pos(const T& key) const {
+            if (has_search_shadow()) return shadow_pos(shadow_slot([&](const T& x) { return comp(x, key); }));
+            return v.lower_bound(key, comp)-v.cbegin();
+        }
+
+        size_type upper_bound_pos(const T& key) const {
+            if (has_search_shadow()) return shadow_pos(shadow_slot([&](const T& x) { return !comp(key, x); }));
+            return v.upper_bound(key, comp)-v.cbegin();
+        }
+
+        // Walks down the implicit tree going right while pred holds. The
+        // answer is the last node where the walk went left: strip the
+        // trailing right turns (low 1 bits of k+1) and one more level.
+        // Returns that slot plus one, or 0 when pred holds everywhere.
+        template<typename Pred>
+        size_type shadow_slot(Pred pred) const {
+            const size_type n=shadow_keys.size();
+            size_type k=0;
+            while (k<n) {
+#if defined(__GNUC__)
+                if (16*k+15<n) __builtin_prefetch(&shadow_keys[16*k+15]);    //4 levels down
+#endif
+                k=2*k+1+pred(shadow_keys[k]);
+            }
+            k+=1;
+            while (k&1) k>>=1;
+            return k>>1;
+        }
+        size_type shadow_pos(const size_type k) const { return k==0 ? shadow_keys.size() : shadow_rank[k-1]; }
+
+        void shadow_fill(std::vector<size_type>& rank, const size_type k, size_type& next) const {
+            if (k>=rank.size()) return;
+            shadow_fill(rank, 2*k+1, next);
+            rank[k]=next++;
+            shadow_fill(rank, 2*k+2, next);
+        }
+
+        base_type v;
+        Compare comp;
+        std::vector<T> shadow_keys;         //Eytzinger order; empty when dropped
+        std::vector<size_type> shadow_rank; //shadow_keys[k] == v[shadow_rank[k]]
+};
+
+template<typename T, typename Compare = std::less<T> >
+using stable_flat_set = sorted_stable_vector<T, Compare, true>;
+
+#endif
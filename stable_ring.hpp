@@ -0,0 +1,216 @@
+#ifndef STABLE_RING_HPP
+#define STABLE_RING_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed-capacity ring of stable nodes. The index is circular: logical
+// position i lives in slot (head+i) mod capacity. When full, push_back
+// evicts the oldest element and reuses its node for the new one, so no
+// allocation or back-pointer fix-up happens in steady state.
+//
+// Iterators hold a pointer to their ring as well as to the node, so swap()
+// invalidates every iterator of both rings, end() included. References and
+// pointers to elements stay valid and follow the elements.
+template<typename T>
+class stable_ring {
+    private:
+        struct node;
+
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        template<typename Value> class ring_iterator;
+        typedef ring_iterator<T> iterator;
+        typedef ring_iterator<const T> const_iterator;
+
+        explicit stable_ring(const size_type n):v(n, nullptr), head(0), count(0) {
+            if (n==0) throw std::invalid_argument("stable_ring: capacity must be positive");
+        }
+
+        stable_ring(const stable_ring& rhs):v(rhs.v.size(), nullptr), head(0), count(0) {
+            try {
+                for (const_iterator it=rhs.begin(); it!=rhs.end(); ++it) push_back(*it);
+            }
+            catch(...) {
+                clear();
+                throw;
+            }
+        }
+
+        stable_ring& operator=(const stable_ring& rhs) {
+            stable_ring(rhs).swap(*this);
+            return *this;
+        }
+
+        ~stable_ring() { clear(); }
+
+        reference at(const size_type pos) { return pos < size() ? (*this)[pos] : throw std::range_error("stable_ring: out of range"); }
+        const_reference at(const size_type pos) const { return pos < size() ? (*this)[pos] : throw std::range_error("stable_ring: out of range"); }
+
+        reference operator[](const size_type pos) { return v[slot(pos)]->datum; }
+        const_reference operator[](const size_type pos) const { return v[slot(pos)]->datum; }
+
+        reference front() { return v[head]->datum; }
+        const_reference front() const { return v[head]->datum; }
+
+        reference back() { return v[slot(count-1)]->datum; }
+        const_reference back() const { return v[slot(count-1)]->datum; }
+
+        iterator begin() { return iterator(this, count ? v[head] : nullptr); }
+        const_iterator begin() const { return const_iterator(this, count ? v[head] : nullptr); }
+        const_iterator cbegin() const { return begin(); }
+
+        iterator end() { return iterator(this, nullptr); }
+        const_iterator end() const { return const_iterator(this, nullptr); }
+        const_iterator cend() const { return end(); }
+
+        bool empty() const { return count==0; }
+        bool full() const { return count==v.size(); }
+        size_type size() const { return count; }
+        size_type capacity() const { return v.size(); }
+
+        void clear() { while (count) pop_back(); head=0; }
+
+        // Evicts front() first when full; its node is reused for value.
+        void push_back(const T& value) {
+            if (full()) {
+                v[head]->datum=value;
+                head=slot(1);
+            }
+            else {
+                size_type s=slot(count);
+                v[s]=new node({value, s});
+                ++count;
+            }
+        }
+
+        void pop_front() {
+            if (empty()) return;
+            delete v[head];
+            v[head]=nullptr;
+            head=slot(1);
+            --count;
+        }
+
+        void pop_back() {
+            if (empty()) return;
+            size_type s=slot(count-1);
+            delete v[s];
+            v[s]=nullptr;
+            --count;
+        }
+
+        iterator erase(const_iterator pos) {
+            if (pos==cbegin()) { pop_front(); return begin(); }
+            if (pos==cend()-1) { pop_back(); return end(); }
+            throw std::invalid_argument("stable_ring: only the front or back can be erased");
+        }
+
+        // Iterators are not swapped; see the class comment.
+        void swap(stable_ring& other) {
+            v.swap(other.v);
+            std::swap(head, other.head);
+            std::swap(count, other.count);
+        }
+
+        friend bool operator==(const stable_ring& lhs, const stable_ring& rhs) {
+            return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+        }
+        friend bool operator!=(const stable_ring& lhs, const stable_ring& rhs) { return !(lhs == rhs); }
+
+        template<typename Value>
+        class ring_iterator {
+            friend class stable_ring;
+
+            public:
+                typedef stable_ring::difference_type difference_type;
+                typedef typename std::remove_const<Value>::type value_type;
+                typedef Value* pointer;
+                typedef Value& reference;
+                typedef std::random_access_iterator_tag iterator_category;
+
+                ring_iterator():r(nullptr), n(nullptr) {}
+                ring_iterator(const stable_ring* const r_, node* const n_):r(r_), n(n_) {}
+                ring_iterator(const ring_iterator<T>& rhs):r(rhs.r), n(rhs.n) {}
+
+                reference operator*() const { return n->datum; }
+                pointer operator->() const { return std::addressof(operator*()); }
+                reference operator[](const difference_type i) const { return *(*this+i); }
+
+                ring_iterator& operator+=(const difference_type i) {
+                    size_type p=position()+i;
+                    n = p==r->count ? nullptr : r->v[r->slot(p)];
+                    return *this;
+                }
+                ring_iterator& operator-=(const difference_type i) { return *this+=-i; }
+
+                friend ring_iterator operator+(ring_iterator it, const difference_type i) { return it+=i; }
+                friend ring_iterator operator+(const difference_type i, ring_iterator it) { return it+=i; }
+                friend ring_iterator operator-(ring_iterator it, const difference_type i) { return it-=i; }
+                friend difference_type operator-(const ring_iterator lhs, const ring_iterator rhs) {
+                    return static_cast<difference_type>(lhs.position())-static_cast<difference_type>(rhs.position());
+                }
+
+                ring_iterator& operator++() { return *this=*this+1; }
+                ring_iterator operator++(int) {
+                    ring_iterator it(*this);
+                    ++*this;
+                    return it;
+                }
+
+                ring_iterator& operator--() { return *this=*this-1; }
+                ring_iterator operator--(int) {
+                    ring_iterator it(*this);
+                    --*this;
+                    return it;
+                }
+
+                friend bool operator==(const ring_iterator lhs, const ring_iterator rhs) { return lhs.n==rhs.n; }
+                friend bool operator!=(const ring_iterator lhs, const ring_iterator rhs) { return !(lhs==rhs); }
+                friend bool operator< (const ring_iterator lhs, const ring_iterator rhs) { return (lhs-rhs)<0; }
+                friend bool operator<=(const ring_iterator lhs, const ring_iterator rhs) { return !(rhs<lhs); }
+                friend bool operator> (const ring_iterator lhs, const ring_iterator rhs) { return rhs<lhs; }
+                friend bool operator>=(const ring_iterator lhs, const ring_iterator rhs) { return !(lhs<rhs); }
+
+            private:
+                size_type position() const { return n ? r->position(n) : r->count; }
+
+                const stable_ring* r;
+                node* n;
+
+                template<typename> friend class ring_iterator;
+        };
+
+    private:
+        struct node {
+            T datum;
+            size_type slot;     //固定不變, 不需要update
+        };
+
+        std::vector<node*> v;
+        size_type head, count;
+
+        size_type slot(const size_type pos) const {
+            size_type s=head+pos;
+            return s>=v.size() ? s-v.size() : s;
+        }
+
+        size_type position(const node* const n) const {
+            return n->slot>=head ? n->slot-head : n->slot+v.size()-head;
+        }
+};
+
+#endif
@@ -1,19 +1,247 @@
 #ifndef STABLE_VECTOR_HPP
 #define STABLE_VECTOR_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <iostream>
 
-template<typename T>
+//resize(n, default_init): 新元素 default-initialize (int 之類不歸零)
+struct default_init_t {};
+static const default_init_t default_init = default_init_t();
+
+//Allocator 定義 caches_single_nodes (例如 shared_node_allocator) 時, 節點一個一個向它要, 不另外配置 slab
+template<typename Allocator, typename = void>
+struct caches_single_nodes : std::false_type {};
+template<typename Allocator>
+struct caches_single_nodes<Allocator, typename std::conditional<true, void, typename Allocator::caches_single_nodes>::type>
+    : Allocator::caches_single_nodes {};
+
+//大量建構和 update() 的平行設定, 所有 stable_vector 共用.
+//threads: 最多幾個 thread (0 = hardware_concurrency); fixup_threshold: update() 超過這麼多個節點才分段
+struct stable_vector_parallel {
+    static std::atomic<unsigned>& threads() { static std::atomic<unsigned> n(0); return n; }
+    static std::atomic<std::size_t>& fixup_threshold() { static std::atomic<std::size_t> n(1<<20); return n; }
+};
+
+//平行的 update() 和大量建構用的 thread, 所有 stable_vector 共用. 第一次需要時才開, 之後留著等下一個工作,
+//所以每次只花叫醒 thread 的時間, 不用每次開新的 thread 再 join
+class stable_vector_workers {
+    public:
+        static stable_vector_workers& get() { static stable_vector_workers w; return w; }
+
+        //chunk(0), ..., chunk(chunks-1) 都做完才回來, 呼叫者自己也拿 chunk 做, 開不了 thread 時一樣做得完.
+        //chunk 不可以丟出例外. 同時只跑一個工作: 已經有工作在跑 (別的 thread, 或 chunk 裡又呼叫 run) 時直接依序做
+        template<typename Chunk>
+        void run(const std::size_t chunks, Chunk& chunk) {
+            std::unique_lock<std::mutex> serial(run_lock, std::try_to_lock);
+            if (!serial || chunks<2) {
+                for (std::size_t i=0; i!=chunks; ++i) chunk(i);
+                return;
+            }
+            start(chunks-1);
+            std::unique_lock<std::mutex> lock(m);
+            fn=&call<Chunk>;
+            ctx=&chunk;
+            total=chunks;
+            next=done=0;
+            ++generation;
+            for (std::size_t t=1; t!=chunks; ++t) wake.notify_one();   //只叫醒需要的幾個
+            take(lock);
+            finished.wait(lock, [this]() { return done==total; });
+        }
+
+        ~stable_vector_workers() {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stopping=true;
+            }
+            wake.notify_all();
+            for (std::size_t t=0; t!=threads.size(); ++t) threads[t].join();
+        }
+
+    private:
+        stable_vector_workers():fn(nullptr), ctx(nullptr), total(0), next(0), done(0), generation(0), stopping(false) {}
+
+        template<typename Chunk>
+        static void call(void* const c, const std::size_t i) { (*static_cast<Chunk*>(c))(i); }
+
+        //開到 n 個 thread 為止; 開不了就算了
+        void start(const std::size_t n) {
+            try {
+                while (threads.size()<n) threads.push_back(std::thread([this]() { loop(); }));
+            }
+            catch(...) {}
+        }
+
+        void loop() {
+            std::unique_lock<std::mutex> lock(m);
+            for (std::size_t seen=0;;) {
+                wake.wait(lock, [&]() { return stopping || generation!=seen; });
+                if (stopping) return;
+                seen=generation;
+                take(lock);
+            }
+        }
+
+        //拿還沒做的 chunk 來做, 做的時候不拿著 m
+        void take(std::unique_lock<std::mutex>& lock) {
+            while (next<total) {
+                const std::size_t i=next++;
+                lock.unlock();
+                fn(ctx, i);
+                lock.lock();
+                if (++done==total) finished.notify_all();
+            }
+        }
+
+        std::mutex run_lock;
+        std::mutex m;
+        std::condition_variable wake, finished;
+        std::vector<std::thread> threads;
+        void (*fn)(void*, std::size_t);
+        void* ctx;
+        std::size_t total, next, done, generation;
+        bool stopping;
+};
+
+//stable_vector 的 index: 前 N 個位置放在物件裡面, 放不下才向 Allocator 要.
+//只放指標這種 trivially copyable 的東西, 搬動都是 memmove; 只有 stable_vector 用到的那些操作
+template<typename T, std::size_t N, typename Allocator>
+class small_index {
+    static_assert(std::is_trivially_copyable<T>::value && N>0, "small_index: T must be trivially copyable, N > 0");
+    typedef std::allocator_traits<Allocator> traits;
+
+    public:
+        typedef T value_type;
+        typedef T* iterator;
+        typedef const T* const_iterator;
+        typedef std::size_t size_type;
+        typedef Allocator allocator_type;
+
+        //local 也清成零: insert 的 memmove 長度是 0 時 g++ -O1 仍會當成讀了未初始化的 local 而警告
+        explicit small_index(const Allocator& a):alloc(a), first(local), count(0), cap(N), local() {}
+        small_index(const size_type n, const T& value, const Allocator& a):alloc(a), first(local), count(0), cap(N), local() { insert(first, n, value); }
+        small_index(const small_index&) = delete;
+        small_index& operator=(const small_index&) = delete;
+        ~small_index() { release(); }
+
+        allocator_type get_allocator() const { return alloc; }
+
+        iterator begin() { return first; }
+        const_iterator begin() const { return first; }
+        iterator end() { return first+count; }
+        const_iterator end() const { return first+count; }
+
+        size_type size() const { return count; }
+        size_type capacity() const { return cap; }
+        bool is_inline() const { return first==local; }
+
+        T& operator[](const size_type i) { return first[i]; }
+        const T& operator[](const size_type i) const { return first[i]; }
+        T& back() { return first[count-1]; }
+        const T& back() const { return first[count-1]; }
+
+        void reserve(const size_type n) { if (n>cap) reallocate(n); }
+
+        void push_back(const T& x) {
+            const T copy=x;
+            if (count==cap) reallocate(std::max<size_type>(2*cap, count+1));
+            first[count++]=copy;
+        }
+
+        iterator insert(const_iterator pos, const T& x) { return insert(pos, 1, x); }
+        iterator insert(const_iterator pos, const size_type n, const T& x) {
+            const T copy=x;
+            const size_type i=pos-first;
+            if (count+n>cap) reallocate(std::max<size_type>(2*cap, count+n));
+            std::memmove(static_cast<void*>(first+i+n), first+i, (count-i)*sizeof(T));
+            std::fill(first+i, first+i+n, copy);
+            count+=n;
+            return first+i;
+        }
+
+        iterator erase(const_iterator a, const_iterator b) {
+            const size_type i=a-first, n=b-a;
+            std::memmove(static_cast<void*>(first+i), first+i+n, (count-i-n)*sizeof(T));
+            count-=n;
+            return first+i;
+        }
+
+        //兩邊都在 heap 上才是交換指標; 有一邊在物件裡時複製內容
+        void swap(small_index& other) {
+            if (!is_inline() && !other.is_inline()) {
+                std::swap(first, other.first);
+                std::swap(count, other.count);
+                std::swap(cap, other.cap);
+            }
+            else {
+                small_index tmp(alloc);
+                tmp.take(*this);
+                take(other);
+                other.take(tmp);
+            }
+            std::swap(alloc, other.alloc);
+        }
+
+    private:
+        //*this 必須是空的且在物件裡; from 之後變成空的
+        void take(small_index& from) {
+            if (from.is_inline()) std::memcpy(static_cast<void*>(local), from.local, from.count*sizeof(T));
+            else {
+                first=from.first;
+                cap=from.cap;
+                from.first=from.local;
+                from.cap=N;
+            }
+            count=from.count;
+            from.count=0;
+        }
+
+        void reallocate(const size_type n) {
+            T* const p=traits::allocate(alloc, n);
+            std::memcpy(static_cast<void*>(p), first, count*sizeof(T));
+            release();
+            first=p;
+            cap=n;
+        }
+
+        void release() { if (!is_inline()) traits::deallocate(alloc, first, cap); }
+
+        Allocator alloc;
+        T* first;
+        size_type count, cap;
+        T local[N];
+};
+
+//NodeAlign 用: 每個節點對齊並補滿一條 cache line, 不同 thread 改相鄰元素時不會 false sharing
+static const std::size_t cache_line_align = 64;
+
+//InlineSlots: 這麼多個元素以內 index 不配置記憶體 (end() 的位置另外留在物件裡)
+//NodeAlign: 節點至少對齊到這麼多 byte, 大小也補成它的倍數 (0 = 只照 T 本身的對齊)
+template<typename T, typename Allocator = std::allocator<T>, std::size_t InlineSlots = 0, std::size_t NodeAlign = 0>
 class stable_vector {
+    static_assert((NodeAlign & (NodeAlign-1))==0, "stable_vector: NodeAlign must be 0 or a power of two");
+
     private:
+        struct node_base;
         struct node;
+        typedef std::allocator_traits<Allocator> alloc_traits;
+        typedef small_index<node_base*, InlineSlots+1, typename alloc_traits::template rebind_alloc<node_base*> > vector_type;
 
     public:
         typedef T value_type;
@@ -23,87 +251,160 @@ class stable_vector {
         typedef const T& const_reference;
         typedef std::size_t size_type; 
         typedef std::ptrdiff_t difference_type; 
+        typedef Allocator allocator_type;
 
         class iterator;
         class const_iterator;
+
+        struct edit {
+            enum op_type { insert_op, erase_op };
+            op_type op;
+            size_type pos;      //position in the container before the batch
+            T value;
+        };
     
-        void update(typename std::vector<node*>::iterator a) {
-            if (v.front()->up!=v.begin()) a=v.begin();    //之前已resize
-            for (; a!=v.end(); ++a) { (*a)->up=a; }
+        void update(typename vector_type::iterator a) {
+            if (v[head]->up!=v.begin()+head) a=v.begin()+head;    //之前已resize
+            const size_type n=v.end()-a;
+            if (n<stable_vector_parallel::fixup_threshold()) {
+                for (; a!=v.end(); ++a) { (*a)->up=a; }
+                return;
+            }
+            //每個節點只寫自己的 up, 可以分段
+            parallel_for(n, worker_count(n), [a](const size_type b, const size_type e) { for (size_type i=b; i!=e; ++i) a[i]->up=a+i; });
         }
     
-        stable_vector():v({new node}) { v[0]->up=v.begin(); }
+        //空的時候不配置任何記憶體: end() 的節點和 index 的第一個位置都在物件裡
+        stable_vector():v(Allocator()), head(0), pool(Allocator()) { init_sentinel(); }
+        explicit stable_vector(const Allocator& a):v(a), head(0), pool(a) { init_sentinel(); }
 
-        explicit stable_vector(const size_type n, const T& value = T()) {
-            v.resize(n+1);
-            for (typename std::vector<node*>::iterator a=v.begin(); a!=v.end(); ++a) {
-                *a=new node({value,a});     //已update
+        explicit stable_vector(const size_type n, const T& value = T(), const Allocator& al = Allocator()):v(al), head(0), pool(al) {
+            init_sentinel();
+            try {
+                v.insert(v.begin(), n, nullptr);
+                build_nodes(n, [&](node* const p, typename vector_type::iterator a, size_type) { place_node(p, a, value); });
             }
+            catch(...) { abandon(); throw; }
+            update(v.end()-1);
         }
 
         template<typename InputIterator>
-        stable_vector(InputIterator first, InputIterator last, typename std::enable_if<!std::is_integral<InputIterator>::value>::type* = nullptr) {
-            v.resize(static_cast<size_type>(last-first)+1);
-            for (typename std::vector<node*>::iterator a=v.begin(); a!=v.end(); ++first,++a) {
-                if (a!=v.end()-1) *a=new node({*first,a});    //已update
-                else *a=new node({0,a});    //已update
-            }
+        stable_vector(InputIterator first, InputIterator last, const Allocator& al = Allocator(), typename std::enable_if<!std::is_integral<InputIterator>::value>::type* = nullptr)
+            :v(al), head(0), pool(al) {
+            init_sentinel();
+            try { init_range(first, last, typename std::iterator_traits<InputIterator>::iterator_category()); }    //已update
+            catch(...) { abandon(); throw; }
         }
 
-        stable_vector(const stable_vector& rhs) {
-            v.resize(rhs.v.size());
-            const_iterator it=rhs.begin();
-            for (typename std::vector<node*>::iterator a=v.begin(); a!=v.end(); ++it,++a) {
-                *a=new node({*it,a});    //已update
+        //同一個 slab 連續配置, 大的時候平行建構
+        stable_vector(const stable_vector& rhs)
+            :v(alloc_traits::select_on_container_copy_construction(rhs.get_allocator())), head(0), pool(v.get_allocator()) {
+            init_sentinel();
+            try {
+                v.insert(v.begin(), rhs.size(), nullptr);
+                const typename vector_type::const_iterator src=rhs.v.begin()+rhs.head;
+                build_nodes(rhs.size(), [&](node* const p, typename vector_type::iterator a, const size_type i) {
+                    place_clone(p, a, datum(src[i]), std::is_trivially_copyable<T>());
+                });
             }
+            catch(...) { abandon(); throw; }
+            update(v.end()-1);
         }
 
         stable_vector& operator=(const stable_vector& rhs) {
-            stable_vector<T>(rhs).swap(*this);
+            stable_vector(rhs).swap(*this);
             return *this;
         }
 
-        ~stable_vector() { clear(); delete v[0]; }
+        ~stable_vector() { clear(); }
+
+        allocator_type get_allocator() const { return allocator_type(v.get_allocator()); }
 
+        //沿用現有節點: 前面的直接覆寫, 只整批配置/釋放多出來或不夠的部分
         void assign(const size_type n, const T& value) {
-            *this=stable_vector<T>(n,value);
+            typename vector_type::iterator a=v.begin()+head;
+            for (size_type f=std::min(n, size()); f>0; --f,++a) datum(*a)=value;
+            resize(n, value);
         }
+        //用 std::make_move_iterator 傳入時會 move-assign
         template<typename InputIterator>
         void assign(InputIterator first, InputIterator last, typename std::enable_if<!std::is_integral<InputIterator>::value>::type* = nullptr) {
-            *this=stable_vector<T>(first, last);
+            typename vector_type::iterator a=v.begin()+head;
+            for (; first!=last && a!=v.end()-1; ++first,++a) datum(*a)=*first;
+            if (a!=v.end()-1) erase(const_iterator(*a), cend());
+            else append_range(first, last, typename std::iterator_traits<InputIterator>::iterator_category());
         }
 
         reference at(const size_type pos) { return pos < size() ? (*this)[pos] : throw std::range_error("stable_vector: out of range"); }
         const_reference at(const size_type pos) const { return pos < size() ? (*this)[pos] : throw std::range_error("stable_vector: out of range"); }
 
-        reference operator[](const size_type pos){ return v[pos]->datum; }
-        const_reference operator[](const size_type pos) const { return v[pos]->datum; }
+        reference operator[](const size_type pos){ return datum(v[head+pos]); }
+        const_reference operator[](const size_type pos) const { return datum(v[head+pos]); }
 
-        reference front() { return ( *(v.begin()) )->datum; }
-        const_reference front() const { return ( *(v.begin()) )->datum; }
+        reference front() { return datum(v[head]); }
+        const_reference front() const { return datum(v[head]); }
 
-        reference back() { return ( *(v.end()-1) )->datum; }
-        const_reference back() const { return ( *(v.end()-1) )->datum; }
+        reference back() { return datum(*(v.end()-2)); }
+        const_reference back() const { return datum(*(v.end()-2)); }
 
-        iterator begin() { return iterator(*v.begin()); }
-        const_iterator begin() const { return const_iterator(*v.begin()); }
-        const_iterator cbegin() const { return const_iterator(*v.begin()); }
+        iterator begin() { return iterator(v[head]); }
+        const_iterator begin() const { return const_iterator(v[head]); }
+        const_iterator cbegin() const { return const_iterator(v[head]); }
 
         iterator end() { return iterator(*(v.end()-1)); }
         const_iterator end() const { return const_iterator(*(v.end()-1)); }
         const_iterator cend() const { return const_iterator(*(v.end()-1)); }
 
-        bool empty() const { return v.size()==1; }
+        bool empty() const { return v.size()-head==1; }
+
+        size_type size() const { return v.size()-head-1; }
+
+        //O(1): 由 node 的 up 算出位置, x 必須是這個 container 的元素
+        size_type index_of(const_reference x) const { return node_of(x)->link.up-(v.begin()+head); }
+        iterator iterator_to(reference x) { return iterator(const_cast<node_base*>(&node_of(x)->link)); }
+        const_iterator iterator_to(const_reference x) const { return const_iterator(&node_of(x)->link); }
+
+        //呼叫者保證已排序 (對 comp). comp 的參數順序和 std::lower_bound / std::upper_bound 相同
+        iterator lower_bound(const T& key) { return lower_bound(key, std::less<T>()); }
+        const_iterator lower_bound(const T& key) const { return lower_bound(key, std::less<T>()); }
+        template<typename Key, typename Compare>
+        iterator lower_bound(const Key& key, Compare comp) {
+            return iterator(v[head+partition_point_pos([&](const T& x) { return comp(x, key); })]);
+        }
+        template<typename Key, typename Compare>
+        const_iterator lower_bound(const Key& key, Compare comp) const {
+            return const_iterator(v[head+partition_point_pos([&](const T& x) { return comp(x, key); })]);
+        }
+
+        iterator upper_bound(const T& key) { return upper_bound(key, std::less<T>()); }
+        const_iterator upper_bound(const T& key) const { return upper_bound(key, std::less<T>()); }
+        template<typename Key, typename Compare>
+        iterator upper_bound(const Key& key, Compare comp) {
+            return iterator(v[head+partition_point_pos([&](const T& x) { return !comp(key, x); })]);
+        }
+        template<typename Key, typename Compare>
+        const_iterator upper_bound(const Key& key, Compare comp) const {
+            return const_iterator(v[head+partition_point_pos([&](const T& x) { return !comp(key, x); })]);
+        }
 
-        size_type size() const { return v.size()-1; }
+        bool binary_search(const T& key) const { return binary_search(key, std::less<T>()); }
+        template<typename Key, typename Compare>
+        bool binary_search(const Key& key, Compare comp) const {
+            size_type pos=partition_point_pos([&](const T& x) { return comp(x, key); });
+            return pos!=size() && !comp(key, datum(v[head+pos]));
+        }
 
         void clear() { erase(cbegin(), cend()); }
 
         iterator insert(const_iterator pos, const T& value) {
-            typename vector_type::iterator it=v.begin()+(pos-cbegin());
-            v.insert(it, new node({value, it}));
+            if (pos==cbegin() && head) { push_front(value); return begin(); }
+            difference_type d=pos-cbegin();
+            typename vector_type::iterator it=v.begin()+head+d;
+            node_base* n=make_node(it, value);
+            try { it=v.insert(it, n); }
+            catch(...) { destroy_node(n); throw; }
             update(it+1);
-            return begin()+(pos-cbegin());
+            return begin()+d;
         }
         template<typename InputIterator>
         iterator insert(const_iterator pos, InputIterator first, InputIterator last) {
@@ -120,31 +421,108 @@ class stable_vector {
         iterator erase(const_iterator pos) { return erase(pos,pos+1); }
         iterator erase(const_iterator first, const_iterator last) {
             difference_type d1=first-cbegin(), d2=last-first;
-            typename vector_type::iterator it1=v.begin()+d1, it2=it1+d2, a=it1;
-            for (size_type f=a-v.begin();a!=it2;++a,++f) { delete v[f]; }
+            typename vector_type::iterator it1=v.begin()+head+d1, it2=it1+d2;
+            if (d1==0 && it2==v.end()-1) {     //全部刪除: 整個 pool 重設
+                destroy_all(std::is_trivially_destructible<T>());
+                v.erase(v.begin(), v.end()-1);
+                head=0;
+                update(v.begin());
+                return begin();
+            }
+            for (typename vector_type::iterator a=it1; a!=it2; ++a) destroy_node(*a);
+            if (d1==0 && it2!=v.end()-1) {     //從前面刪: 只移動head
+                std::fill(it1, it2, nullptr);
+                head+=d2;
+                trim_front();
+                return begin();
+            }
             v.erase(it1,it2);
-            update(v.begin());
+            update(v.begin()+head+d1);
             return begin()+d1;
         }
 
         void push_back(const T& value) { insert(cend(),value); }
         void pop_back() { if (!empty()) erase(cend()-1); }
 
+        void push_front(const T& value) { emplace_front(value); }
+        template<typename... Args>
+        void emplace_front(Args&&... args) {
+            if (head==0) grow_front();
+            v[head-1]=make_node(v.begin()+head-1, std::forward<Args>(args)...);
+            --head;
+        }
+        void pop_front() { if (!empty()) erase(cbegin()); }
+
+        //index 只長一次, 新節點在同一個 slab 裡一次配好
         void resize(size_type count, const T& value = T()) {
             if (count > size()) {
-                for (size_type f=count-size();f>0;--f) {
-                    insert(cbegin()+size(), value);
-                }
+                append_with(count-size(), [&](typename vector_type::iterator a) { return make_node(a, value); });
+            }
+            else if(count < size()) {
+                erase(cbegin()+count, cend());
+            }
+        }
+        void resize(size_type count, default_init_t) {
+            if (count > size()) {
+                append_with(count-size(), [&](typename vector_type::iterator a) { return make_default_node(a); });
             }
             else if(count < size()) {
                 erase(cbegin()+count, cend());
             }
         }
 
+        //在尾端加 n 個元素, 每個都用 gen() 的結果直接建構
+        template<typename Generator>
+        void append_n(size_type n, Generator gen) {
+            append_with(n, [&](typename vector_type::iterator a) { return make_node(a, gen()); });
+        }
+
+        void apply_edits(const std::vector<edit>& edits) {
+            typedef typename std::vector<edit>::const_iterator edit_iterator;
+            size_type ins=0, last_erased=size();
+            for (edit_iterator e=edits.begin(); e!=edits.end(); ++e) {
+                if ((e!=edits.begin() && e->pos<(e-1)->pos) || e->pos>size())
+                    throw std::invalid_argument("stable_vector: edits not sorted or out of range");
+                if (e->op==edit::insert_op) ++ins;
+                else if (e->pos==size() || e->pos==last_erased)
+                    throw std::invalid_argument("stable_vector: invalid erase in edits");
+                else last_erased=e->pos;
+            }
+            if (edits.empty()) return;
+
+            vector_type w(v.get_allocator());
+            w.reserve(v.size()-head+ins);
+            typename vector_type::iterator src=v.begin()+head;
+            size_type pos=0;
+            try {
+                for (edit_iterator e=edits.begin(); e!=edits.end(); ++e) {
+                    for (; pos<e->pos; ++pos,++src) w.push_back(*src);
+                    if (e->op==edit::insert_op) w.push_back(make_node(v.end(), e->value));
+                    else { ++pos; ++src; }
+                }
+            }
+            catch(...) {
+                for (typename vector_type::iterator a=w.begin(); a!=w.end(); ++a)
+                    if ((*a)->up==v.end()) destroy_node(*a);
+                throw;
+            }
+            for (; src!=v.end(); ++src) w.push_back(*src);
+            for (edit_iterator e=edits.begin(); e!=edits.end(); ++e)
+                if (e->op==edit::erase_op) destroy_node(v[head+e->pos]);
+            v.swap(w);
+            head=0;
+            update(v.begin());
+        }
+
+        //end_node 不跟著交換: 兩邊的 end() 換回自己的 (和 std::vector 一樣, swap 後 end() 失效)
         void swap(stable_vector& other) {
             v.swap(other.v);
-            update(v.begin());
-            other.update(other.v.begin());
+            std::swap(head, other.head);
+            pool.swap(other.pool);
+            v.back()=&end_node;
+            other.v.back()=&other.end_node;
+            update(v.begin()+head);
+            other.update(other.v.begin()+other.head);
         }
 
         friend bool operator==(const stable_vector& lhs, const stable_vector& rhs) {
@@ -168,12 +546,12 @@ class stable_vector {
                 typedef stable_vector::reference reference;
                 typedef std::random_access_iterator_tag iterator_category;
 
-                explicit iterator(node* const n_ = nullptr) :n(n_){}
+                explicit iterator(node_base* const n_ = nullptr) :n(n_){}
                 iterator(const iterator& rhs) {	*this = rhs; }
                 iterator& operator=(const iterator& rhs) { n = rhs.n; return *this; }
                 ~iterator() {}
 
-                reference operator*() const { return n->datum; }
+                reference operator*() const { return datum(n); }
                 pointer operator->() const { return std::addressof(operator*()); }
 
                 friend iterator operator+(iterator it, const difference_type i) {
@@ -212,8 +590,8 @@ class stable_vector {
                     return iterator(it);
                 }
 
-                reference operator[](const difference_type i) { return n->up[i]->datum; }
-                const_reference operator[](const difference_type i) const { return n->up[i]->datum; }
+                reference operator[](const difference_type i) { return datum(n->up[i]); }
+                const_reference operator[](const difference_type i) const { return datum(n->up[i]); }
 
                 operator const_iterator() const { return const_iterator(n); }
 
@@ -225,7 +603,7 @@ class stable_vector {
                 friend bool operator>=(const iterator lhs, const iterator rhs) { return !(lhs<rhs); }
 
             private:
-                node* n;
+                node_base* n;
         };
 
         class const_iterator {
@@ -238,7 +616,7 @@ class stable_vector {
                 typedef stable_vector::reference reference;
                 typedef std::random_access_iterator_tag iterator_category;
 
-                explicit const_iterator(const node* const n_) :n(n_){}
+                explicit const_iterator(const node_base* const n_) :n(n_){}
                 const_iterator(const const_iterator& rhs) { n = rhs.n; }
                 const_iterator& operator=(const const_iterator& rhs) { n = rhs.n; return *this; }
                 ~const_iterator() {}
@@ -265,7 +643,7 @@ class stable_vector {
                     return *this;
                 }
             
-                const_reference operator*() const {return ((*this).n)->datum;}
+                const_reference operator*() const {return datum(n);}
                 const_pointer operator->() const { return std::addressof(operator*()); }
 
                 const_iterator& operator++() { return *this=*this+1; }
@@ -282,7 +660,7 @@ class stable_vector {
                     return it;
                 }
 
-                const_reference operator[](const difference_type i) const { return n->up[i]->datum; }
+                const_reference operator[](const difference_type i) const { return datum(n->up[i]); }
 
                 friend bool operator==(const const_iterator lhs, const const_iterator rhs) { return lhs.n==rhs.n; }
                 friend bool operator!=(const const_iterator lhs, const const_iterator rhs) { return !(lhs==rhs); }
@@ -292,17 +670,390 @@ class stable_vector {
                 friend bool operator>=(const const_iterator lhs, const const_iterator rhs) { return !(lhs<rhs); }
 
             private:
-                const node* n;
+                const node_base* n;
         };
 
     private:
-        typedef std::vector<node*> vector_type;
         vector_type v;
+        size_type head;     //v[0..head) 是前面預留的空位
 
-        struct node {
-            T datum;
+        node_base end_node;     //end(): 不放 T, 不配置
+
+        static const node* node_of(const_reference x) {
+            return reinterpret_cast<const node*>(reinterpret_cast<const char*>(std::addressof(x))-offsetof(node, storage));
+        }
+        //只能用在元素的節點上, end_node 不行
+        static T& datum(node_base* const n) { return reinterpret_cast<node*>(n)->datum(); }
+        static const T& datum(const node_base* const n) { return reinterpret_cast<const node*>(n)->datum(); }
+
+        //第一個 pred 為 false 的位置. 沒有分支: 迴圈次數只看 len, 比較結果只選 base.
+        //index 是連續的, 但每一步還要一次 node 的 load; 先 prefetch 下一步兩個可能的中點節點
+        template<typename Pred>
+        size_type partition_point_pos(Pred pred) const {
+            typename vector_type::const_iterator first=v.begin()+head, base=first;
+            size_type len=size();
+            if (len==0) return 0;
+            while (len>1) {
+                size_type half=len/2, next=(len-half)/2;
+                prefetch(base[next]);
+                prefetch(base[half+next]);
+                base=pred(datum(base[half])) ? base+half : base;
+                len-=half;
+            }
+            return (base-first)+pred(datum(*base));
+        }
+
+        static void prefetch(const node_base* const n) {
+#if defined(__GNUC__)
+            __builtin_prefetch(n);
+#else
+            (void)n;
+#endif
+        }
+
+        enum { min_chunk=16, max_chunk=4096 };
+
+        //長度未知的單次走訪來源 (istream_iterator 等): 分塊讀入
+        template<typename InputIterator>
+        void append_range(InputIterator first, InputIterator last, std::input_iterator_tag) {
+            for (size_type chunk=min_chunk; first!=last; chunk=std::min<size_type>(2*chunk, max_chunk)) {
+                size_type start=v.size()-1;
+                v.insert(v.end()-1, chunk, nullptr);
+                typename vector_type::iterator a=v.begin()+start;
+                try {
+                    pool.reserve(chunk);
+                    for (; a!=v.end()-1 && first!=last; ++first,++a) *a=make_node(a, *first);    //已update
+                }
+                catch(...) {
+                    for (typename vector_type::iterator b=v.begin()+start; b!=a; ++b) destroy_node(*b);
+                    v.erase(v.begin()+start, v.end()-1);
+                    update(v.begin()+start);
+                    throw;
+                }
+                v.erase(a, v.end()-1);     //來源比 chunk 短: 去掉沒用到的空位
+                update(v.begin()+start);   //沒有 reallocate 就只走新的尾端
+            }
+        }
+        template<typename ForwardIterator>
+        void append_range(ForwardIterator first, ForwardIterator last, std::forward_iterator_tag) {
+            append_with(std::distance(first, last), [&](typename vector_type::iterator a) { return make_node(a, *first++); });
+        }
+
+        //建構子: random access 的來源可以分段平行建構
+        template<typename InputIterator>
+        void init_range(InputIterator first, InputIterator last, std::input_iterator_tag tag) { append_range(first, last, tag); }
+        template<typename RandomAccessIterator>
+        void init_range(RandomAccessIterator first, RandomAccessIterator last, std::random_access_iterator_tag) {
+            const size_type n=static_cast<size_type>(last-first);
+            v.insert(v.begin(), n, nullptr);
+            build_nodes(n, [&](node* const p, typename vector_type::iterator a, const size_type i) { place_node(p, a, first[i]); });
+            update(v.end()-1);
+        }
+
+        enum { parallel_threshold=1<<18, parallel_grain=1<<16 };
+
+        //只給建構子用: v[0..n) 是空位. 節點一次從 pool 拿出連續的一段, 超過 parallel_threshold
+        //就切成不重疊的幾段, 每個 thread 建構自己那段並設好 up. 有一段丟出例外時其他段停下來,
+        //建好的節點都已經放進 v (非 nullptr), 例外轉回呼叫端後由 abandon() 收拾
+        template<typename Place>
+        void build_nodes(const size_type n, Place place) {
+            const typename vector_type::iterator first=v.begin();
+            if (node_pool::individual) {    //沒有 slab 可以切: 逐一配置
+                for (size_type i=0; i!=n; ++i) {
+                    node* p=pool.allocate();
+                    try { place(p, first+i, i); }
+                    catch(...) { pool.deallocate(p); throw; }
+                    first[i]=&p->link;
+                }
+                return;
+            }
+            pool.reserve(n);
+            node* const mem=pool.allocate_run(n);
+            std::atomic<bool> failed(false);
+            std::exception_ptr error;
+            std::mutex error_lock;
+            auto work=[&](const size_type b, const size_type e) {
+                try {
+                    for (size_type i=b; i!=e && !failed.load(std::memory_order_relaxed); ++i) {
+                        place(mem+i, first+i, i);
+                        first[i]=&mem[i].link;
+                    }
+                }
+                catch(...) {
+                    std::lock_guard<std::mutex> lock(error_lock);
+                    if (!error) error=std::current_exception();
+                    failed=true;
+                }
+            };
+            parallel_for(n, n>=parallel_threshold ? worker_count(n) : 1, work);
+            if (error) std::rethrow_exception(error);
+        }
+
+        static size_type worker_count(const size_type n) {
+            size_type t=stable_vector_parallel::threads();
+            if (t==0) t=std::thread::hardware_concurrency();
+            return std::max<size_type>(1, std::min<size_type>(t, n/parallel_grain));
+        }
+
+        //[0,n) 切成 threads 段不重疊的範圍, 交給 stable_vector_workers, 呼叫者也一起做. work 不可以丟出例外
+        template<typename Work>
+        static void parallel_for(const size_type n, const size_type threads, Work work) {
+            if (threads<=1) {
+                work(0, n);
+                return;
+            }
+            auto chunk=[&](const std::size_t t) { work(n*t/threads, n*(t+1)/threads); };
+            stable_vector_workers::get().run(threads, chunk);
+        }
+
+        template<typename Maker>
+        void append_with(const size_type n, Maker make) {
+            if (n==0) return;
+            size_type first=v.size()-1;
+            v.insert(v.end()-1, n, nullptr);
+            typename vector_type::iterator a=v.begin()+first;
+            try {
+                pool.reserve(n);
+                for (; a!=v.end()-1; ++a) *a=make(a);   //已update
+            }
+            catch(...) {
+                for (typename vector_type::iterator b=v.begin()+first; b!=a; ++b) destroy_node(*b);
+                v.erase(v.begin()+first, v.end()-1);
+                update(v.begin()+first);
+                throw;
+            }
+            update(v.end()-1);
+        }
+
+        void grow_front() {
+            if (v.is_inline() && v.size()<v.capacity()) {     //物件裡還有空位: 先用它, 不配置
+                head=v.capacity()-v.size();
+                v.insert(v.begin(), head, nullptr);
+                update(v.begin()+head);
+                return;
+            }
+            size_type room=std::max<size_type>(v.size()-head, 16);
+            vector_type w(room+v.size()-head, nullptr, v.get_allocator());
+            std::copy(v.begin()+head, v.end(), w.begin()+room);
+            v.swap(w);
+            head=room;
+            update(v.begin()+head);
+        }
+
+        void trim_front() {
+            size_type live=v.size()-head;
+            if (head>2*live+16) {
+                v.erase(v.begin(), v.begin()+(head-live));
+                head=live;
+                update(v.begin()+head);
+            }
+        }
+
+        struct node_base {
             typename vector_type::iterator up;
         };
+
+        enum : std::size_t {
+            natural_align=alignof(T)>alignof(node_base) ? alignof(T) : alignof(node_base),
+            node_align=NodeAlign>natural_align ? NodeAlign : natural_align
+        };
+
+        //standard layout: link 在最前面, node* 和 node_base* 可以互轉, node_of 用 offsetof 算回來.
+        //alignas(T) 讓 over-aligned 的 T 也放得對; sizeof(node) 是 node_align 的倍數, 在 slab 裡一個接一個都對齊
+        struct alignas(node_align) node {
+            node_base link;
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            T& datum() { return *reinterpret_cast<T*>(storage); }
+            const T& datum() const { return *reinterpret_cast<const T*>(storage); }
+        };
+
+        struct free_node { free_node* next; };
+
+        //節點從 slab 一段一段配置, 釋放的節點串在 free list 上.
+        //reset() 把所有 slab 當成空的重新使用, release() 才還給系統.
+        //individual 時 (caches_single_nodes) 每個節點直接向 Allocator 要, 沒有 slab 和 free list.
+        //over_aligned 的節點一律用 slab: C++17 之前 allocator 不保證超過 max_align_t 的對齊, slab 自己對齊
+        class node_pool {
+            public:
+                enum { over_aligned=node_align>alignof(std::max_align_t) };
+                enum { individual=caches_single_nodes<Allocator>::value && !over_aligned };
+
+                explicit node_pool(const Allocator& a):alloc(a), slabs(a), free_list(nullptr), used(0), cur(nullptr), last(nullptr), total(0) {}
+                node_pool(const node_pool&) = delete;
+                node_pool& operator=(const node_pool&) = delete;
+                ~node_pool() { release(); }
+
+                node* allocate() {
+                    if (individual) return node_traits::allocate(alloc, 1);
+                    if (free_list) {
+                        node* n=reinterpret_cast<node*>(free_list);
+                        free_list=free_list->next;
+                        return n;
+                    }
+                    if (cur==last) next_slab(1);
+                    return cur++;
+                }
+
+                void deallocate(node* const n) {
+                    if (individual) node_traits::deallocate(alloc, n, 1);
+                    else free_list=::new (static_cast<void*>(n)) free_node{free_list};
+                }
+
+                //之後的 n 次 allocate 都在同一個 slab 裡連續配置
+                void reserve(const size_type n) {
+                    if (individual || static_cast<size_type>(last-cur)>=n) return;
+                    for (; cur!=last; ++cur) deallocate(cur);
+                    next_slab(n);
+                }
+
+                void reset() {
+                    free_list=nullptr;
+                    used=0;
+                    cur=last=nullptr;
+                }
+
+                void release() {
+                    for (typename slab_vector::iterator a=slabs.begin(); a!=slabs.end(); ++a) free_slab(*a);
+                    slabs.clear();
+                    total=0;
+                    reset();
+                }
+
+                //reserve(n) 之後: 一次拿走連續 n 個節點
+                node* allocate_run(const size_type n) {
+                    node* n0=cur;
+                    cur+=n;
+                    return n0;
+                }
+
+                void swap(node_pool& other) {
+                    std::swap(alloc, other.alloc);
+                    slabs.swap(other.slabs);
+                    std::swap(free_list, other.free_list);
+                    std::swap(used, other.used);
+                    std::swap(cur, other.cur);
+                    std::swap(last, other.last);
+                    std::swap(total, other.total);
+                }
+
+            private:
+                typedef typename alloc_traits::template rebind_alloc<node> node_allocator;
+                typedef std::allocator_traits<node_allocator> node_traits;
+                typedef typename alloc_traits::template rebind_alloc<char> byte_allocator;
+                typedef std::allocator_traits<byte_allocator> byte_traits;
+
+                struct slab {
+                    node* mem;
+                    size_type count;
+                    char* raw;      //over_aligned 時向 Allocator 要到的那塊; mem 是其中對齊的位置
+                };
+                typedef std::vector<slab, typename alloc_traits::template rebind_alloc<slab> > slab_vector;
+
+                static size_type raw_bytes(const size_type count) { return count*sizeof(node)+alignof(node)-1; }
+
+                slab make_slab(const size_type count) {
+                    if (!over_aligned) {
+                        slab s={node_traits::allocate(alloc, count), count, nullptr};
+                        return s;
+                    }
+                    byte_allocator bytes(alloc);
+                    char* const raw=byte_traits::allocate(bytes, raw_bytes(count));
+                    const std::uintptr_t mem=(reinterpret_cast<std::uintptr_t>(raw)+alignof(node)-1) & ~std::uintptr_t(alignof(node)-1);
+                    slab s={reinterpret_cast<node*>(mem), count, raw};
+                    return s;
+                }
+                void free_slab(const slab& s) {
+                    if (!over_aligned) { node_traits::deallocate(alloc, s.mem, s.count); return; }
+                    byte_allocator bytes(alloc);
+                    byte_traits::deallocate(bytes, s.raw, raw_bytes(s.count));
+                }
+
+                enum { min_slab=16, max_slab=1<<16 };
+
+                //slabs[0..used) 已經開始使用; 下一個不夠大就插入一個新的
+                void next_slab(const size_type n) {
+                    if (used==slabs.size() || slabs[used].count<n) {
+                        size_type count=std::max(n, std::min<size_type>(std::max<size_type>(total, min_slab), max_slab));
+                        slabs.reserve(slabs.size()+1);
+                        slabs.insert(slabs.begin()+used, make_slab(count));
+                        total+=count;
+                    }
+                    cur=slabs[used].mem;
+                    last=cur+slabs[used].count;
+                    ++used;
+                }
+
+                node_allocator alloc;
+                slab_vector slabs;
+                free_node* free_list;
+                size_type used;
+                node* cur;
+                node* last;
+                size_type total;
+        };
+
+        node_pool pool;
+
+        template<typename... Args>
+        node_base* make_node(typename vector_type::iterator up, Args&&... args) {
+            node* n=pool.allocate();
+            try { place_node(n, up, std::forward<Args>(args)...); }
+            catch(...) { pool.deallocate(n); throw; }
+            return &n->link;
+        }
+
+        //在已經拿到的記憶體上建構; 不碰 pool, 所以可以在別的 thread 做
+        template<typename... Args>
+        static void place_node(node* const n, typename vector_type::iterator up, Args&&... args) {
+            ::new (static_cast<void*>(std::addressof(n->storage))) T(std::forward<Args>(args)...);
+            ::new (static_cast<void*>(std::addressof(n->link))) node_base{up};
+        }
+
+        node_base* make_default_node(typename vector_type::iterator up) {
+            node* n=pool.allocate();
+            try { ::new (static_cast<void*>(std::addressof(n->storage))) T; }
+            catch(...) { pool.deallocate(n); throw; }
+            ::new (static_cast<void*>(std::addressof(n->link))) node_base{up};
+            return &n->link;
+        }
+
+        //trivially copyable 的 T 直接 memcpy
+        static void place_clone(node* const n, typename vector_type::iterator up, const T& value, std::true_type) {
+            std::memcpy(static_cast<void*>(std::addressof(n->storage)), std::addressof(value), sizeof(T));
+            ::new (static_cast<void*>(std::addressof(n->link))) node_base{up};
+        }
+        static void place_clone(node* const n, typename vector_type::iterator up, const T& value, std::false_type) { place_node(n, up, value); }
+
+        void destroy_node(node_base* const n) {
+            destroy_value(n, std::is_trivially_destructible<T>());
+            pool.deallocate(reinterpret_cast<node*>(n));
+        }
+        static void destroy_value(node_base* const, std::true_type) {}
+        static void destroy_value(node_base* const n, std::false_type) { datum(n).~T(); }
+
+        //沒有活的節點了, slab 可以整批重用: trivially destructible 時是 O(1)
+        void destroy_all(std::true_type) { release_all(); }
+        void destroy_all(std::false_type) {
+            for (typename vector_type::iterator a=v.begin()+head; a!=v.end()-1; ++a) datum(*a).~T();
+            release_all();
+        }
+        void release_all() {
+            if (!node_pool::individual) { pool.reset(); return; }
+            for (typename vector_type::iterator a=v.begin()+head; a!=v.end()-1; ++a) pool.deallocate(reinterpret_cast<node*>(*a));
+        }
+
+        //建構途中失敗: 已建好的是 v 中非 nullptr 的那些
+        void abandon() {
+            for (typename vector_type::iterator a=v.begin(); a!=v.end()-1; ++a)
+                if (*a) destroy_node(*a);
+        }
+
+        //v 是空的: 放進 end_node, index 第一個位置在物件裡, 不會配置
+        void init_sentinel() {
+            v.push_back(&end_node);
+            end_node.up=v.begin();
+        }
 };
 
 #endif
@@ -40,17 +40,19 @@ struct node_type
   T& value(){return *static_cast<T*>(static_cast<void*>(&spc));}
 };
 
+class node_access;
+
 template<typename T,typename Value>
 class iterator:
   public boost::iterator_facade<
     iterator<T,Value>,Value,std::random_access_iterator_tag>
 {
-  typedef node_type<T> node_type;
+  typedef stable_vector_detail::node_type<T> node_type;
 
 public:
   iterator(){}
   explicit iterator(node_type* pn):pn(pn){}
-  iterator(const iterator<T,T>& x):pn(node_access::get(x)){}
+  iterator(const iterator<T,T>& x):pn(x.pn){}
 
 private:
   static node_type* node_ptr(void* p){return static_cast<node_type*>(p);}
@@ -65,6 +67,7 @@ private:
   std::ptrdiff_t distance_to(const iterator& x)const{return x.pn->up-pn->up;}
 
   friend class node_access;
+  template<typename,typename> friend class iterator;
 
   node_type* pn;
 };
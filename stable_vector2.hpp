@@ -29,22 +29,57 @@
 #include <boost/assert.hpp>
 #include <boost/container/throw_exception.hpp>
 #include <boost/container/detail/allocator_version_traits.hpp>
-#include <boost/container/detail/utilities.hpp>
 #include <boost/container/detail/iterators.hpp>
-#include <boost/container/detail/algorithms.hpp>
 #include <boost/container/allocator_traits.hpp>
 #include <boost/container/throw_exception.hpp>
 #include <boost/intrusive/pointer_traits.hpp>
 #include <boost/core/no_exceptions_support.hpp>
 #include <boost/aligned_storage.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
 #include <boost/move/utility_core.hpp>
 #include <boost/move/iterator.hpp>
 #include <boost/move/detail/move_helpers.hpp>
 #include <boost/container/detail/placement_new.hpp>
+#include <boost/version.hpp>
+#if BOOST_VERSION >= 105600
+//Boost 1.56 split up the detail headers, later renamed container_detail to dtl
+//and dropped these macros: map the names this file uses onto the current ones
+#include <boost/container/detail/alloc_helpers.hpp>
+#include <boost/container/detail/iterator.hpp>
+#include <boost/container/detail/mpl.hpp>
+#include <boost/container/detail/type_traits.hpp>
+#include <boost/move/detail/iterator_to_raw_pointer.hpp>
+#include <boost/move/detail/to_raw_pointer.hpp>
+#include <boost/core/addressof.hpp>
+#include <boost/intrusive/detail/reverse_iterator.hpp>
+#include <boost/move/adl_move_swap.hpp>
+#include <boost/preprocessor.hpp>
+namespace boost { namespace container {
+    namespace dtl {
+        using boost::movelib::to_raw_pointer;
+        using boost::addressof;
+        using boost::intrusive::reverse_iterator;
+    }
+    namespace container_detail = dtl;
+    template<class T>
+    inline void swap_dispatch(T& a, T& b) { boost::adl_move_swap(a, b); }
+}}
+#ifndef BOOST_CONTAINER_NOEXCEPT
+#define BOOST_CONTAINER_NOEXCEPT BOOST_NOEXCEPT_OR_NOTHROW
+#define BOOST_CONTAINER_NOEXCEPT_IF(x) BOOST_NOEXCEPT_IF(x)
+#endif
+#if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES) && !defined(BOOST_CONTAINER_PERFECT_FORWARDING)
+#define BOOST_CONTAINER_PERFECT_FORWARDING
+#endif
+#else
+#include <boost/container/detail/utilities.hpp>
+#include <boost/container/detail/algorithms.hpp>
+#endif
 #include <algorithm>
 
 
 #include <memory>
+#include <vector>
 
 #ifndef BOOST_CONTAINER_DOXYGEN_INVOKED
 
@@ -91,6 +126,19 @@ namespace boost {
                 bool do_clear_;
             };
             
+            //Whether Allocator has a destroy member callable with a T*: if it does,
+            //it must be called even when T's destructor is trivial
+            template<class Allocator, class T>
+            struct allocator_has_destroy
+            {
+            private:
+                template<class A> static A& make();
+                template<class A> static char test(int (*)[sizeof((make<A>().destroy(static_cast<T*>(0)), 0))]);
+                template<class A> static int test(...);
+            public:
+                static const bool value = sizeof(test<Allocator>(0)) == sizeof(char);
+            };
+            
             template<typename Pointer>
             struct node;
             
@@ -412,11 +460,14 @@ BOOST_JOIN(check_invariant_,__LINE__).touch();
 #ifdef BOOST_CONTAINER_DOXYGEN_INVOKED
         template <class T, class Allocator = std::allocator<T> >
 #else
-        template <class T, class Allocator>
+        template <class T, class AllocatorOrVoid>
 #endif
         class stable_vector
         {
 #ifndef BOOST_CONTAINER_DOXYGEN_INVOKED
+            //Newer container_fwd.hpp declares the default allocator as void
+            typedef typename container_detail::if_c<container_detail::is_same<AllocatorOrVoid, void>::value,
+                std::allocator<T>, AllocatorOrVoid>::type         Allocator;
             typedef allocator_traits<Allocator>                allocator_traits_type;
             typedef boost::intrusive::
             pointer_traits
@@ -509,10 +560,22 @@ BOOST_JOIN(check_invariant_,__LINE__).touch();
             typedef BOOST_CONTAINER_IMPDEF(container_detail::reverse_iterator<iterator>)        reverse_iterator;
             typedef BOOST_CONTAINER_IMPDEF(container_detail::reverse_iterator<const_iterator>)  const_reverse_iterator;
             
+            //! One operation of an edit script passed to apply_edits(). pos is the
+            //! position of the element in the container before the batch is applied.
+            struct edit
+            {
+                enum op_type { insert_op, erase_op };
+                op_type    op;
+                size_type  pos;
+                value_type value;
+            };
+            
 #ifndef BOOST_CONTAINER_DOXYGEN_INVOKED
         private:
             BOOST_COPYABLE_AND_MOVABLE(stable_vector)
             static const size_type ExtraPointers = index_traits_type::ExtraPointers;
+            //Nodes a trimming erasure may release besides twice the ones it erased
+            static const size_type TrimStepNodes = 32;
             
             class insert_rollback;
             friend class insert_rollback;
@@ -1139,6 +1202,62 @@ BOOST_JOIN(check_invariant_,__LINE__).touch();
                 }
             }
             
+            //! Statistics of the node pool, where erased nodes are cached for reuse.
+            struct pool_stats
+            {
+                size_type pool_size;       //!< Nodes cached now
+                size_type peak_pool_size;  //!< Largest pool_size seen
+                size_type trim_steps;      //!< Erasures that released cached nodes
+                size_type nodes_trimmed;   //!< Nodes released by trimming
+            };
+            
+            //! <b>Requires</b>: low <= high.
+            //!
+            //! <b>Effects</b>: Once more than high nodes are cached in the pool, every
+            //!   following erasure also releases some cached nodes back to the allocator,
+            //!   until at most low remain. Each erasure releases at most 32 nodes plus
+            //!   twice the number it erased, so the cost is amortized over the erasures.
+            //!   By default both are size_type(-1) and the pool is never trimmed.
+            //!
+            //! <b>Throws</b>: Nothing.
+            //!
+            //! <b>Complexity</b>: Constant.
+            void set_pool_limits(size_type high, size_type low) BOOST_CONTAINER_NOEXCEPT
+            {
+                BOOST_ASSERT(low <= high);
+                this->internal_data.pool_high = high;
+                this->internal_data.pool_low  = low;
+            }
+            
+            //! <b>Effects</b>: Returns the pool size above which erasures start trimming.
+            //!
+            //! <b>Throws</b>: Nothing.
+            //!
+            //! <b>Complexity</b>: Constant.
+            size_type pool_high_watermark() const BOOST_CONTAINER_NOEXCEPT
+            {  return this->internal_data.pool_high;  }
+            
+            //! <b>Effects</b>: Returns the pool size at which trimming stops.
+            //!
+            //! <b>Throws</b>: Nothing.
+            //!
+            //! <b>Complexity</b>: Constant.
+            size_type pool_low_watermark() const BOOST_CONTAINER_NOEXCEPT
+            {  return this->internal_data.pool_low;  }
+            
+            //! <b>Effects</b>: Returns the current size of the node pool and counts of
+            //!   the trimming done so far.
+            //!
+            //! <b>Throws</b>: Nothing.
+            //!
+            //! <b>Complexity</b>: Constant.
+            pool_stats get_pool_stats() const BOOST_CONTAINER_NOEXCEPT
+            {
+                const pool_stats st = { this->internal_data.pool_size, this->internal_data.pool_peak
+                                      , this->internal_data.trim_steps, this->internal_data.nodes_trimmed };
+                return st;
+            }
+            
             //////////////////////////////////////////////
             //
             //               element access
@@ -1500,7 +1619,9 @@ return iterator(this->begin() + pos_n);
                 this->priv_delete_node(p.node_pointer());
                 it = this->index.erase(it);
                 index_traits_type::fix_up_pointers_from(this->index, it);
-                return iterator(node_ptr_traits::static_cast_from(*it));
+                const iterator ret(node_ptr_traits::static_cast_from(*it));
+                this->priv_trim_pool(1u);
+                return ret;
             }
             
             //! <b>Effects</b>: Erases the elements pointed by [first, last).
@@ -1531,6 +1652,7 @@ return iterator(this->begin() + pos_n);
                     this->priv_put_in_pool(holder);
                     const index_iterator e = this->index.erase(it1, it2);
                     index_traits_type::fix_up_pointers_from(this->index, e);
+                    this->priv_trim_pool(d2 - d1);
                 }
                 return iterator(last.node_pointer());
             }
@@ -1558,6 +1680,104 @@ return iterator(this->begin() + pos_n);
             void clear() BOOST_CONTAINER_NOEXCEPT
             {   this->erase(this->cbegin(),this->cend()); }
             
+            //! <b>Requires</b>: edits is sorted by pos. Insertions at the same pos keep
+            //!   their relative order and are placed before the element at pos. Each
+            //!   position is erased at most once.
+            //!
+            //! <b>Effects</b>: Applies the whole batch of insertions and erasures in a
+            //!   single sweep, rebuilding the index once and fixing up pointers once.
+            //!   References to elements not erased remain valid.
+            //!
+            //! <b>Throws</b>: std::logic_error if edits is not sorted or out of range.
+            //!   If memory allocation throws or T's copy constructor throws the container
+            //!   is left unchanged.
+            //!
+            //! <b>Complexity</b>: Linear to size() plus edits.size().
+            //!
+            //! <b>Note</b>: Non-standard extension
+            void apply_edits(const std::vector<edit> &edits)
+            {
+                STABLE_VECTOR_CHECK_INVARIANT;
+                typedef typename std::vector<edit>::const_iterator edit_iterator;
+                const size_type sz = this->size();
+                size_type num_new = 0, num_erased = 0, last_erased = sz;
+                for(edit_iterator e = edits.begin(); e != edits.end(); ++e){
+                    if((e != edits.begin() && e->pos < (e-1)->pos) || e->pos > sz){
+                        throw_logic_error("stable_vector::apply_edits edits not sorted or out of range");
+                    }
+                    if(e->op == edit::insert_op){
+                        ++num_new;
+                    }
+                    else if(e->pos == sz || e->pos == last_erased){
+                        throw_logic_error("stable_vector::apply_edits invalid erase position");
+                    }
+                    else{
+                        last_erased = e->pos;
+                        ++num_erased;
+                    }
+                }
+                if(!num_new && !num_erased){
+                    return;
+                }
+                
+                //Fill the pool so that no allocation is needed while the new index is built
+                index_traits_type::initialize_end_node(this->index, this->internal_data.end_node, num_new);
+                if(this->internal_data.pool_size < num_new){
+                    this->priv_increase_pool(num_new - this->internal_data.pool_size);
+                }
+                index_type new_index(this->index.get_stored_allocator());
+                new_index.reserve(sz + num_new - num_erased + ExtraPointers);
+                
+                //New nodes are built with a null up pointer, which tells them apart from
+                //old ones if T's constructor throws and the batch must be rolled back
+                index_iterator src = this->index.begin();
+                size_type pos = 0;
+                BOOST_TRY{
+                    for(edit_iterator e = edits.begin(); e != edits.end(); ++e){
+                        for(; pos < e->pos; ++pos, ++src){
+                            new_index.push_back(*src);
+                        }
+                        if(e->op == edit::insert_op){
+                            const node_ptr p = this->priv_get_from_pool();
+                            push_back_rollback rollback(*this, p);
+                            this->priv_build_node_from_convertible(p, e->value);
+                            rollback.release();
+                            new_index.push_back(p);
+                        }
+                        else{
+                            ++pos;
+                            ++src;
+                        }
+                    }
+                }
+                BOOST_CATCH(...){
+                    for(index_iterator it = new_index.begin(); it != new_index.end(); ++it){
+                        if(!(*it)->up){
+                            this->priv_delete_node(node_ptr_traits::static_cast_from(*it));
+                        }
+                    }
+                    BOOST_RETHROW;
+                }
+                BOOST_CATCH_END
+                //Copy the rest of the elements plus the end node and the pool pointers
+                new_index.insert(new_index.end(), src, this->index.end());
+                this->index.swap(new_index);
+                
+                multiallocation_chain holder;
+                for(edit_iterator e = edits.begin(); e != edits.end(); ++e){
+                    if(e->op == edit::erase_op){
+                        node_type &n = *node_ptr_traits::static_cast_from(new_index[e->pos]);
+                        this->priv_destroy_node(n);
+                        holder.push_back(node_ptr_traits::pointer_to(n));
+                    }
+                }
+                if(num_erased){
+                    this->priv_put_in_pool(holder);
+                }
+                index_traits_type::fix_up_pointers_from(this->index, this->index.begin());
+                this->priv_trim_pool(num_erased);
+            }
+            
             //! <b>Effects</b>: Returns true if x and y are equal
             //!
             //! <b>Complexity</b>: Linear to the number of elements in the container.
@@ -1726,6 +1946,58 @@ return iterator(this->begin() + pos_n);
                     this->deallocate_individual(holder);
                     pool_first_ref = pool_last_ref = 0;
                     this->internal_data.pool_size = 0;
+                    this->internal_data.pool_trimming = false;
+                }
+            }
+            
+            //Called after an erasure of num_freed nodes: starts trimming above the
+            //high watermark and releases a bounded slice of the pool until the low one
+            void priv_trim_pool(size_type num_freed)
+            {
+                ebo_holder &d = this->internal_data;
+                if(!d.pool_trimming){
+                    if(d.pool_size <= d.pool_high){
+                        return;
+                    }
+                    d.pool_trimming = true;
+                }
+                const size_type budget = TrimStepNodes + 2*num_freed;
+                const size_type excess = d.pool_size > d.pool_low ? d.pool_size - d.pool_low : 0;
+                const size_type n = excess < budget ? excess : budget;
+                if(n){
+                    node_base_ptr &pool_first_ref = *(this->index.end() - (ExtraPointers-1));
+                    node_base_ptr &pool_last_ref  = this->index.back();
+                    multiallocation_chain holder;
+                    holder.incorporate_after( holder.before_begin()
+                                             , node_ptr_traits::static_cast_from(pool_first_ref)
+                                             , node_ptr_traits::static_cast_from(pool_last_ref)
+                                             , d.pool_size);
+                    multiallocation_chain released;
+                    for(size_type i = 0; i != n; ++i){
+                        released.push_back(holder.pop_front());
+                    }
+                    this->deallocate_individual(released);
+                    d.pool_size -= n;
+                    if(!d.pool_size){
+                        pool_first_ref = pool_last_ref = node_ptr();
+                    }
+                    else{
+                        const std::pair<node_ptr, node_ptr> data(holder.extract_data());
+                        pool_first_ref = data.first;
+                        pool_last_ref  = data.second;
+                    }
+                    ++d.trim_steps;
+                    d.nodes_trimmed += n;
+                }
+                if(d.pool_size <= d.pool_low){
+                    d.pool_trimming = false;
+                }
+            }
+            
+            void priv_note_pool_size()
+            {
+                if(this->internal_data.pool_size > this->internal_data.pool_peak){
+                    this->internal_data.pool_peak = this->internal_data.pool_size;
                 }
             }
             
@@ -1742,6 +2014,7 @@ return iterator(this->begin() + pos_n);
                 this->allocate_individual(n, m);
                 holder.splice_after(holder.before_begin(), m, m.before_begin(), m.last(), n);
                 this->internal_data.pool_size += n;
+                this->priv_note_pool_size();
                 std::pair<node_ptr, node_ptr> data(holder.extract_data());
                 pool_first_ref = data.first;
                 pool_last_ref = data.second;
@@ -1758,6 +2031,7 @@ return iterator(this->begin() + pos_n);
                                          , internal_data.pool_size);
                 holder.push_front(p);
                 ++this->internal_data.pool_size;
+                this->priv_note_pool_size();
                 std::pair<node_ptr, node_ptr> ret(holder.extract_data());
                 pool_first_ref = ret.first;
                 pool_last_ref  = ret.second;
@@ -1772,6 +2046,7 @@ return iterator(this->begin() + pos_n);
                                      , node_ptr_traits::static_cast_from(pool_last_ref)
                                      , internal_data.pool_size);
                 this->internal_data.pool_size = ch.size();
+                this->priv_note_pool_size();
                 const std::pair<node_ptr, node_ptr> ret(ch.extract_data());
                 pool_first_ref = ret.first;
                 pool_last_ref  = ret.second;
@@ -1805,6 +2080,18 @@ return iterator(this->begin() + pos_n);
             {  return node_base_ptr_traits::pointer_to(const_cast<node_base_type&>(this->internal_data.end_node));  }
             
             void priv_destroy_node(const node_type &n)
+            {
+                typedef container_detail::bool_<boost::has_trivial_destructor<value_type>::value &&
+                    !stable_vector_detail::allocator_has_destroy<node_allocator_type, value_type>::value> trivial_t;
+                this->priv_destroy_node(n, trivial_t());
+            }
+            
+            //Trivial destructor and no allocator destroy to call: erase and clear
+            //only hand the nodes back to the pool
+            void priv_destroy_node(const node_type &, container_detail::true_)
+            {}
+            
+            void priv_destroy_node(const node_type &n, container_detail::false_)
             {
                 allocator_traits<node_allocator_type>::
                 destroy(this->priv_node_alloc(), container_detail::addressof(n.value));
@@ -1845,6 +2132,12 @@ return iterator(this->begin() + pos_n);
             void priv_swap_members(stable_vector &x)
             {
                 boost::container::swap_dispatch(this->internal_data.pool_size, x.internal_data.pool_size);
+                boost::container::swap_dispatch(this->internal_data.pool_high, x.internal_data.pool_high);
+                boost::container::swap_dispatch(this->internal_data.pool_low, x.internal_data.pool_low);
+                boost::container::swap_dispatch(this->internal_data.pool_peak, x.internal_data.pool_peak);
+                boost::container::swap_dispatch(this->internal_data.trim_steps, x.internal_data.trim_steps);
+                boost::container::swap_dispatch(this->internal_data.nodes_trimmed, x.internal_data.nodes_trimmed);
+                boost::container::swap_dispatch(this->internal_data.pool_trimming, x.internal_data.pool_trimming);
                 index_traits_type::readjust_end_node(this->index, this->internal_data.end_node);
                 index_traits_type::readjust_end_node(x.index, x.internal_data.end_node);
             }
@@ -1905,16 +2198,23 @@ return iterator(this->begin() + pos_n);
                 explicit ebo_holder(BOOST_FWD_REF(AllocatorRLValue) a)
                 : node_allocator_type(boost::forward<AllocatorRLValue>(a))
                 , pool_size(0)
+                , pool_high(size_type(-1)), pool_low(size_type(-1)), pool_peak(0)
+                , trim_steps(0), nodes_trimmed(0), pool_trimming(false)
                 , end_node()
                 {}
                 
                 ebo_holder()
                 : node_allocator_type()
                 , pool_size(0)
+                , pool_high(size_type(-1)), pool_low(size_type(-1)), pool_peak(0)
+                , trim_steps(0), nodes_trimmed(0), pool_trimming(false)
                 , end_node()
                 {}
                 
                 size_type pool_size;
+                size_type pool_high, pool_low;   //set_pool_limits
+                size_type pool_peak, trim_steps, nodes_trimmed;
+                bool pool_trimming;
                 node_base_type end_node;
             } internal_data;
             
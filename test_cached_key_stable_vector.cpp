@@ -0,0 +1,92 @@
+//
+//  test_cached_key_stable_vector.cpp
+//  HW6
+//
+//  Checks cached_key_stable_vector against a std::vector given the same
+//  inserts, erases and replaces, then sort and lower_bound over the cached
+//  keys, and that a throwing projection changes nothing. A failing check
+//  aborts through assert.
+//
+//  Build: g++ -std=c++11 -g test_cached_key_stable_vector.cpp && ./a.out
+//
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "cached_key_stable_vector.hpp"
+
+template<typename Container, typename Model>
+static bool same(const Container& c, const Model& model) {
+    if (c.size() != model.size() || c.empty() != model.empty()) return false;
+    if (static_cast<std::size_t>(c.end() - c.begin()) != model.size()) return false;
+    return std::equal(model.begin(), model.end(), c.begin());
+}
+
+//key is the value itself; negative values make the projection throw
+struct checked_key {
+    int operator()(const int x) const {
+        if (x < 0) throw std::invalid_argument("checked_key");
+        return x;
+    }
+};
+
+static void test_cached_keys() {
+    std::mt19937 rng(5);
+    typedef cached_key_stable_vector<int, checked_key> ck_type;
+    ck_type c;
+    std::vector<int> model;
+    for (int step = 0; step < 3000; ++step) {
+        const unsigned r = rng() % 8;
+        if (r < 2) {    //front inserts reallocate the index now and then
+            c.insert(c.cbegin(), step);
+            model.insert(model.begin(), step);
+        }
+        else if (r < 5) {
+            const std::size_t pos = rng() % (model.size() + 1);
+            c.insert(c.cbegin() + pos, step);
+            model.insert(model.begin() + pos, step);
+        }
+        else if (r < 6 && !model.empty()) {
+            const std::size_t pos = rng() % model.size();
+            c.erase(c.cbegin() + pos);
+            model.erase(model.begin() + pos);
+        }
+        else if (!model.empty()) {
+            const std::size_t pos = rng() % model.size();
+            const int* p = &c.cbegin()[pos];
+            c.replace(c.cbegin() + pos, step + 10000);
+            model[pos] = step + 10000;
+            assert(&c.cbegin()[pos] == p);
+        }
+        if (step % 97 == 0) assert(same(c, model));
+    }
+    assert(same(c, model));
+
+    //a throwing projection leaves element and key alone
+    const std::size_t pos = model.size() / 2;
+    const int old = model[pos];
+    bool threw = false;
+    try { c.replace(c.cbegin() + pos, -1); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw && same(c, model) && c.find(old) == c.cbegin() + pos);
+    threw = false;
+    try { c.insert(c.cbegin(), -1); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw && same(c, model));
+
+    c.sort();
+    std::sort(model.begin(), model.end());
+    assert(same(c, model));
+    for (int k = 0; k < 200; ++k) {
+        const int key = static_cast<int>(rng() % 14000);
+        assert(c.lower_bound(key) - c.cbegin() == std::lower_bound(model.begin(), model.end(), key) - model.begin());
+    }
+}
+
+int main() {
+    test_cached_keys();
+    std::cout << "test_cached_key_stable_vector: all passed" << std::endl;
+    return 0;
+}
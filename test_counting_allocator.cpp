@@ -0,0 +1,113 @@
+//
+//  test_counting_allocator.cpp
+//  HW6
+//
+//  Checks the exact counts allocation_stats reports: first for requests
+//  made straight through counting_allocator, then for a known resize,
+//  erase and push_back sequence on stable_vector, whose index and slab
+//  growth fix every request. A failing check aborts through assert.
+//
+//  Build: g++ -std=c++11 -g test_counting_allocator.cpp && ./a.out
+//
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+
+#include "counting_allocator.hpp"
+#include "stable_vector.hpp"
+
+static void test_direct() {
+    allocation_stats stats(2);
+    counting_allocator<int> a(&stats);
+    counting_allocator<double> b(a);    //a rebound copy reports to the same stats
+    assert(b == a && b.statistics() == &stats);
+
+    int* p = a.allocate(10);                            //40 bytes, op 0
+    stats.set_op(1);
+    double* q = b.allocate(3);                          //24 bytes, op 1
+    a.deallocate(p, 10);
+    int* r = a.allocate(1);                             //4 bytes, op 1
+    assert(stats.all().allocations == 3 && stats.all().bytes_allocated == 68);
+    assert(stats.all().deallocations == 1 && stats.all().bytes_deallocated == 40);
+    assert(stats.live_bytes() == 28 && stats.high_water_bytes() == 64);
+    assert(stats.for_op(0).allocations == 1 && stats.for_op(0).bytes_allocated == 40 && stats.for_op(0).deallocations == 0);
+    assert(stats.for_op(1).allocations == 2 && stats.for_op(1).bytes_allocated == 28);
+    assert(stats.for_op(1).deallocations == 1 && stats.for_op(1).bytes_deallocated == 40);
+    assert(stats.in_size_class(5) == 1 && stats.in_size_class(4) == 1 && stats.in_size_class(2) == 1 && stats.in_size_class(3) == 0);
+    std::ostringstream out;
+    out << stats;
+    assert(out.str() == "allocs=3 frees=1 bytes=68 live=28 high_water=64 classes=[4:1 16:1 32:1]");
+
+    //reset keeps the live bytes, and the high-water mark restarts from them
+    stats.reset();
+    assert(stats.all().allocations == 0 && stats.for_op(1).bytes_allocated == 0 && stats.in_size_class(5) == 0);
+    assert(stats.live_bytes() == 28 && stats.high_water_bytes() == 28);
+    int* big = a.allocate(25);                          //100 bytes
+    a.deallocate(big, 25);
+    b.deallocate(q, 3);
+    a.deallocate(r, 1);
+    assert(stats.all().allocations == 1 && stats.all().deallocations == 3 && stats.all().bytes_deallocated == 128);
+    assert(stats.live_bytes() == 0 && stats.high_water_bytes() == 128);
+
+    //without stats it only forwards
+    counting_allocator<int> plain;
+    assert(plain != a && plain.statistics() == nullptr);
+    plain.deallocate(plain.allocate(7), 7);
+}
+
+//stable_vector<long> with no inline slots. Its index holds the element
+//pointers plus one for end() and grows to max(2*capacity, needed); nodes
+//are a long and an up pointer, cut from slabs of max(needed, 16, nodes so
+//far); the slab list is a vector of three-word records grown by one
+static void test_stable_vector_sequence() {
+    const std::uint64_t word = sizeof(void*), node = sizeof(long) + sizeof(void*), slab_record = 3 * word;
+    allocation_stats stats(3);
+    typedef counting_allocator<long> alloc;
+    {
+        stable_vector<long, alloc> c((alloc(&stats)));
+        assert(stats.all().allocations == 0);
+
+        //resize: one index of 21 slots, one slab of 20 nodes, one slab record
+        c.resize(20);
+        const std::uint64_t first = 21 * word + 20 * node + slab_record;
+        assert(stats.all().allocations == 3 && stats.all().deallocations == 0);
+        assert(stats.all().bytes_allocated == first && stats.live_bytes() == first && stats.high_water_bytes() == first);
+
+        //erasing keeps the nodes on the free list and the index capacity
+        stats.set_op(1);
+        for (int i = 0; i < 5; ++i) c.erase(c.begin() + 3);
+        assert(stats.for_op(1).allocations == 0 && stats.for_op(1).deallocations == 0);
+
+        //five pushes reuse the freed nodes and fill the index exactly
+        stats.set_op(2);
+        for (long i = 0; i < 5; ++i) c.push_back(i);
+        assert(stats.for_op(2).allocations == 0 && stats.for_op(2).deallocations == 0);
+
+        //the sixth needs a second slab of 20 nodes (the slab list moves to
+        //two records), then an index of 42 slots
+        c.push_back(5);
+        assert(stats.for_op(2).allocations == 3 && stats.for_op(2).deallocations == 2);
+        assert(stats.for_op(2).bytes_allocated == 20 * node + 2 * slab_record + 42 * word);
+        assert(stats.for_op(2).bytes_deallocated == slab_record + 21 * word);
+        const std::uint64_t live = first + 20 * node + slab_record + 21 * word;
+        assert(stats.live_bytes() == live);
+        //the old index is released only after the new one is filled
+        assert(stats.high_water_bytes() == live + 21 * word);
+
+        //clear keeps everything for reuse
+        c.clear();
+        assert(stats.all().deallocations == 2 && stats.live_bytes() == live);
+    }
+    //the destructor returns the index, both slabs and the slab list
+    assert(stats.all().allocations == 6 && stats.all().deallocations == 6);
+    assert(stats.all().bytes_allocated == stats.all().bytes_deallocated && stats.live_bytes() == 0);
+}
+
+int main() {
+    test_direct();
+    test_stable_vector_sequence();
+    std::cout << "test_counting_allocator: all passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,152 @@
+//
+//  test_intrusive_stable_vector.cpp
+//  HW6
+//
+//  Checks intrusive_stable_vector against a std::vector of object addresses
+//  given the same inserts, range inserts, erases and swaps, and that a range
+//  holding an already linked or repeated object links nothing. A failing
+//  check aborts through assert.
+//
+//  Build: g++ -std=c++11 -g test_intrusive_stable_vector.cpp && ./a.out
+//
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "intrusive_stable_vector.hpp"
+
+struct item : stable_vector_hook {
+    int value;
+    explicit item(const int v = 0):value(v) {}
+};
+
+typedef intrusive_stable_vector<item> ivec;
+
+//forward iterator over a list of addresses, so a range can repeat an object
+struct item_iterator {
+    typedef std::forward_iterator_tag iterator_category;
+    typedef item value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef item* pointer;
+    typedef item& reference;
+
+    std::vector<item*>::const_iterator p;
+    item& operator*() const { return **p; }
+    item_iterator& operator++() { ++p; return *this; }
+    item_iterator operator++(int) { item_iterator it(*this); ++p; return it; }
+    friend bool operator==(const item_iterator lhs, const item_iterator rhs) { return lhs.p == rhs.p; }
+    friend bool operator!=(const item_iterator lhs, const item_iterator rhs) { return lhs.p != rhs.p; }
+};
+
+static ivec::iterator insert_all(ivec& c, const std::size_t pos, const std::vector<item*>& run) {
+    item_iterator first = { run.begin() }, last = { run.end() };
+    return c.insert(c.cbegin() + pos, first, last);
+}
+
+//same objects in the same order, and every hook knows its position
+static bool same(const ivec& c, const std::vector<item*>& model) {
+    if (c.size() != model.size() || c.empty() != model.empty()) return false;
+    if (static_cast<std::size_t>(c.end() - c.begin()) != model.size()) return false;
+    std::size_t i = 0;
+    for (ivec::const_iterator it = c.begin(); it != c.end(); ++it, ++i) {
+        if (&*it != model[i] || &c[i] != model[i]) return false;
+        if (c.index_of(*model[i]) != i || c.iterator_to(*model[i]) - c.begin() != static_cast<long>(i)) return false;
+        if (!model[i]->is_linked()) return false;
+    }
+    return true;
+}
+
+static void test_model() {
+    std::mt19937 rng(11);
+    std::vector<item> pool(400);
+    for (std::size_t i = 0; i < pool.size(); ++i) pool[i].value = static_cast<int>(i);
+    ivec a, b;
+    std::vector<item*> ma, mb;
+    for (int step = 0; step < 4000; ++step) {
+        ivec& c = step % 2 ? a : b;
+        std::vector<item*>& m = step % 2 ? ma : mb;
+        item& x = pool[rng() % pool.size()];
+        const std::size_t pos = rng() % (m.size() + 1);
+        switch (rng() % 6) {
+            case 0:
+            case 1:
+                if (x.is_linked()) break;
+                assert(&*c.insert(c.cbegin() + pos, x) == &x);
+                m.insert(m.begin() + pos, &x);
+                break;
+            case 2: {
+                //a run of unlinked objects, inserted in one go
+                std::vector<item*> run;
+                for (std::size_t k = rng() % pool.size(), n = 0; n < 5 && k < pool.size(); ++k, ++n)
+                    if (!pool[k].is_linked()) run.push_back(&pool[k]);
+                ivec::iterator it = insert_all(c, pos, run);
+                assert(it - c.begin() == static_cast<long>(pos));
+                m.insert(m.begin() + pos, run.begin(), run.end());
+                break;
+            }
+            case 3:
+                if (m.empty()) break;
+                c.erase(c.cbegin() + pos % m.size());
+                assert(!m[pos % m.size()]->is_linked());
+                m.erase(m.begin() + pos % m.size());
+                break;
+            case 4:
+                if (step % 50 == 0) {
+                    a.swap(b);
+                    ma.swap(mb);
+                }
+                break;
+            default:
+                if (step % 300 == 0) {
+                    for (item* p : m) assert(p->is_linked());
+                    c.clear();
+                    for (item* p : m) assert(!p->is_linked());
+                    m.clear();
+                }
+                break;
+        }
+        assert(same(a, ma) && same(b, mb));
+    }
+}
+
+//a range that repeats an object, or holds one linked elsewhere, is refused
+//without linking any of its objects
+static void test_rejected_ranges() {
+    std::vector<item> pool(6);
+    ivec c, other;
+    c.push_back(pool[0]);
+    other.push_back(pool[5]);
+    std::vector<item*> model(1, &pool[0]);
+
+    bool thrown = false;
+    try { insert_all(c, 1, { &pool[1], &pool[2], &pool[1], &pool[3] }); }
+    catch (const std::invalid_argument&) { thrown = true; }
+    assert(thrown && same(c, model));
+    for (int k = 1; k < 5; ++k) assert(!pool[k].is_linked());
+
+    thrown = false;
+    try { insert_all(c, 0, { &pool[1], &pool[2], &pool[5] }); }
+    catch (const std::invalid_argument&) { thrown = true; }
+    assert(thrown && same(c, model));
+    assert(!pool[1].is_linked() && !pool[2].is_linked());
+    assert(other.index_of(pool[5]) == 0);
+
+    //the refused objects are still free to go in
+    const std::vector<item*> run = { &pool[1], &pool[2], &pool[3], &pool[4] };
+    ivec::iterator it = insert_all(c, 0, run);
+    assert(it == c.begin());
+    model.insert(model.begin(), run.begin(), run.end());
+    assert(same(c, model));
+}
+
+int main() {
+    test_model();
+    test_rejected_ranges();
+    std::cout << "test_intrusive_stable_vector: all passed" << std::endl;
+    return 0;
+}
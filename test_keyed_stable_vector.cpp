@@ -0,0 +1,174 @@
+//
+//  test_keyed_stable_vector.cpp
+//  HW6
+//
+//  Checks keyed_stable_vector against a std::vector given the same inserts,
+//  erases, replaces, assigns, clears, swaps and copies, and after every step
+//  that find_by_key answers for exactly the keys held. A clustering hash
+//  makes long probe runs that wrap around the table, so erase has to shift
+//  entries back across them. A failing check aborts through assert.
+//
+//  Build: g++ -std=c++11 -g test_keyed_stable_vector.cpp && ./a.out
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "keyed_stable_vector.hpp"
+
+typedef std::pair<int, int> entry;     //key, payload
+
+struct key_of_entry {
+    int operator()(const entry& e) const { return e.first; }
+};
+
+//three keys per home slot
+struct clustered_hash {
+    std::size_t operator()(const int key) const { return static_cast<std::size_t>(key / 3) * 5 + 11; }
+};
+
+//keys 0..15 land four apiece on slots 14, 15, 16 and 17: in the smallest
+//table (16 slots, up to 8 elements) that is one run wrapping past the end
+struct wrapping_hash {
+    std::size_t operator()(const int key) const { return static_cast<std::size_t>(key / 4) + 14; }
+};
+
+template<typename Container, typename Model>
+static bool same(const Container& c, const Model& model) {
+    if (c.size() != model.size() || c.empty() != model.empty()) return false;
+    if (static_cast<std::size_t>(c.end() - c.begin()) != model.size()) return false;
+    return std::equal(model.begin(), model.end(), c.begin());
+}
+
+//find_by_key hits an element of c with that key exactly when the model has one
+template<typename Keyed>
+static bool keys_ok(const Keyed& c, const std::vector<entry>& model, const int range) {
+    for (int key = -1; key <= range; ++key) {
+        const bool held = std::find_if(model.begin(), model.end(), [&](const entry& e) { return e.first == key; }) != model.end();
+        typename Keyed::const_iterator it = c.find_by_key(key);
+        if ((it != c.end()) != held || c.contains_key(key) != held) return false;
+        if (held && (it->first != key || &c[c.index_of(*it)] != &*it)) return false;
+    }
+    return true;
+}
+
+template<typename Hash>
+static void test_model(const unsigned seed) {
+    typedef keyed_stable_vector<entry, key_of_entry, Hash> keyed;
+    std::mt19937 rng(seed);
+    const int range = 120;
+    keyed a, b;
+    std::vector<entry> ma, mb;
+    for (int step = 0; step < 6000; ++step) {
+        keyed& c = step % 3 ? a : b;
+        std::vector<entry>& m = step % 3 ? ma : mb;
+        const entry e(static_cast<int>(rng() % range), step);
+        const std::size_t pos = rng() % (m.size() + 1);
+        switch (rng() % 16) {
+            case 0: case 1: case 2:
+                c.push_back(e);
+                m.push_back(e);
+                break;
+            case 3: case 4: case 5: {
+                typename keyed::iterator it = c.insert(c.cbegin() + pos, e);
+                assert(it - c.begin() == static_cast<long>(pos) && *it == e);
+                m.insert(m.begin() + pos, e);
+                break;
+            }
+            case 6: case 7: case 8:
+                if (m.empty()) break;
+                c.erase(c.cbegin() + pos % m.size());
+                m.erase(m.begin() + pos % m.size());
+                break;
+            case 9: {
+                const std::size_t last = std::min(m.size(), pos + rng() % 8);
+                c.erase(c.cbegin() + pos, c.cbegin() + last);
+                m.erase(m.begin() + pos, m.begin() + last);
+                break;
+            }
+            case 10: case 11:
+                if (m.empty()) break;
+                c.replace(c.cbegin() + pos % m.size(), e);
+                m[pos % m.size()] = e;
+                break;
+            case 12:
+                c.pop_back();
+                if (!m.empty()) m.pop_back();
+                break;
+            case 13:
+                if (step % 20 == 0) {
+                    c.swap(step % 3 ? b : a);
+                    ma.swap(mb);
+                }
+                else if (step % 20 == 1) {
+                    //a copy indexes its own elements, not the source's
+                    keyed copy(c);
+                    assert(same(copy, m) && keys_ok(copy, m, range));
+                    c.clear();
+                    assert(same(c, std::vector<entry>()) && keys_ok(c, std::vector<entry>(), range));
+                    c = copy;
+                    copy.clear();
+                }
+                break;
+            case 14:
+                if (step % 40 == 0) {
+                    c.clear();
+                    m.clear();
+                }
+                else if (step % 40 == 1) {
+                    c.assign(rng() % 5, e);
+                    m.assign(c.size(), e);
+                }
+                break;
+            default:
+                if (step % 30 == 0) {
+                    std::vector<entry> fresh;
+                    for (int k = 0, n = static_cast<int>(rng() % 60); k < n; ++k) fresh.push_back(entry(static_cast<int>(rng() % range), k));
+                    c.assign(fresh.begin(), fresh.end());
+                    m = fresh;
+                }
+                break;
+        }
+        assert(same(a, ma) && same(b, mb));
+        assert(keys_ok(a, ma, range) && keys_ok(b, mb, range));
+    }
+}
+
+//fills the smallest table with one wrapped run and empties it in random
+//order, so every backward shift crosses the end of the table
+static void test_wrapped_run() {
+    typedef keyed_stable_vector<entry, key_of_entry, wrapping_hash> keyed;
+    std::mt19937 rng(3);
+    std::vector<int> keys;
+    for (int k = 0; k < 16; ++k) keys.push_back(k);
+    for (int round = 0; round < 2000; ++round) {
+        std::shuffle(keys.begin(), keys.end(), rng);
+        keyed c;
+        std::vector<entry> m;
+        for (int k = 0; k < 8; ++k) {
+            c.push_back(entry(keys[k], k));
+            m.push_back(entry(keys[k], k));
+        }
+        assert(keys_ok(c, m, 16));
+        while (!m.empty()) {
+            const std::size_t pos = rng() % m.size();
+            c.erase(c.cbegin() + pos);
+            m.erase(m.begin() + pos);
+            assert(same(c, m) && keys_ok(c, m, 16));
+        }
+    }
+}
+
+int main() {
+    test_model<std::hash<int> >(1);
+    test_model<clustered_hash>(2);
+    test_wrapped_run();
+    std::cout << "test_keyed_stable_vector: all passed" << std::endl;
+    return 0;
+}
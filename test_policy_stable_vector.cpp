@@ -0,0 +1,100 @@
+//
+//  test_policy_stable_vector.cpp
+//  HW6
+//
+//  Checks policy_stable_vector with every index backend, under eager and
+//  deferred fix-up, against a std::vector given the same iterator and
+//  positional inserts and erases; index_of and iterator distances are
+//  checked along the way. A failing check aborts through assert.
+//
+//  Build: g++ -std=c++11 -g test_policy_stable_vector.cpp && ./a.out
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "policy_stable_vector.hpp"
+
+template<typename Container, typename Model>
+static bool same(const Container& c, const Model& model) {
+    if (c.size() != model.size() || c.empty() != model.empty()) return false;
+    if (static_cast<std::size_t>(c.end() - c.begin()) != model.size()) return false;
+    return std::equal(model.begin(), model.end(), c.begin());
+}
+
+//every element must know its own position
+template<typename Container>
+static bool positions_ok(const Container& c) {
+    for (std::size_t i = 0; i < c.size(); ++i)
+        if (c.index_of(c[i]) != i || &*(c.begin() + i) != &c[i]) return false;
+    return true;
+}
+
+//every backend and fix-up against a std::vector; sizes cross several segmented_index blocks
+template<typename Policy>
+static void test_policy() {
+    std::mt19937 rng(8);
+    policy_stable_vector<int, Policy> c;
+    std::vector<int> model;
+    for (int i = 0; i < 3000; ++i) {
+        c.push_back(i);
+        model.push_back(i);
+    }
+    for (int step = 0; step < 4000; ++step) {
+        const std::size_t pos = rng() % (model.size() + 1);
+        switch (rng() % 6) {
+            case 0:
+                c.insert(c.cbegin() + pos, step);
+                model.insert(model.begin() + pos, step);
+                break;
+            case 1: {
+                const std::size_t n = rng() % 700;     //can split a block into several
+                c.insert_at(pos, n, step);
+                model.insert(model.begin() + pos, n, step);
+                break;
+            }
+            case 2:
+                if (pos < model.size()) {
+                    c.erase(c.cbegin() + pos);
+                    model.erase(model.begin() + pos);
+                }
+                break;
+            case 3: {
+                const std::size_t n = std::min<std::size_t>(rng() % 900, model.size() - pos);
+                c.erase_at(pos, pos + n);
+                model.erase(model.begin() + pos, model.begin() + pos + n);
+                break;
+            }
+            case 4:
+                c.insert_at(pos, step);
+                model.insert(model.begin() + pos, step);
+                break;
+            default:
+                if (pos < model.size()) {
+                    assert(c.index_of(c[pos]) == pos && c.cbegin() + pos - c.cbegin() == static_cast<std::ptrdiff_t>(pos));
+                    assert(*(c.cbegin() + pos) == model[pos]);
+                }
+        }
+        if (step % 211 == 0) assert(same(c, model) && positions_ok(c));
+    }
+    c.reserve(4 * model.size());
+    assert(same(c, model) && positions_ok(c));
+}
+
+template<template<typename> class Index>
+static void test_policy_fixups() {
+    test_policy<sv_policy::policy<Index, sv_policy::slab_nodes, sv_policy::eager_fixup> >();
+    test_policy<sv_policy::policy<Index, sv_policy::pooled_nodes, sv_policy::deferred_fixup> >();
+}
+
+int main() {
+    test_policy_fixups<sv_policy::flat_index>();
+    test_policy_fixups<sv_policy::segmented_index>();
+    test_policy_fixups<sv_policy::gap_index>();
+    std::cout << "test_policy_stable_vector: all passed" << std::endl;
+    return 0;
+}
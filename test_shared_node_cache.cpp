@@ -0,0 +1,146 @@
+//
+//  test_shared_node_cache.cpp
+//  HW6
+//
+//  Checks shared_node_cache across threads: blocks allocated on one thread
+//  and freed on another come back through the depot without the cache
+//  reserving more memory, no block is handed out twice, and frees made
+//  after a thread's cache is gone are merged into full batches. The tests
+//  use the 48-byte class only, so every reserved byte of it is either held
+//  by a test or waiting in the depot. A failing check aborts through assert.
+//
+//  Build: g++ -std=c++11 -g -pthread test_shared_node_cache.cpp && ./a.out
+//  (also worth running with -fsanitize=thread)
+//
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "shared_node_cache.hpp"
+
+static const std::size_t block_bytes = 48;
+
+//every block stamped with its owner and serial, so a block handed out to
+//two holders at once shows up as a torn stamp
+struct stamp {
+    std::size_t owner, serial;
+};
+
+static void* take(const std::size_t owner, const std::size_t serial) {
+    void* p = shared_node_cache::allocate(block_bytes);
+    stamp s = { owner, serial };
+    std::memcpy(p, &s, sizeof(s));
+    std::memset(static_cast<char*>(p) + sizeof(s), static_cast<int>(owner), block_bytes - sizeof(s));
+    return p;
+}
+
+static void check(void* const p, const std::size_t owner, const std::size_t serial) {
+    stamp s;
+    std::memcpy(&s, p, sizeof(s));
+    assert(s.owner == owner && s.serial == serial);
+    for (std::size_t i = sizeof(s); i < block_bytes; ++i)
+        assert(static_cast<unsigned char*>(p)[i] == static_cast<unsigned char>(owner));
+}
+
+//with no test holding blocks, all of them are back in the depot
+static void check_all_returned() {
+    shared_node_cache::stats s = shared_node_cache::statistics();
+    assert(s.depot_blocks * block_bytes == s.reserved_bytes);
+}
+
+//one queue per producer/consumer pair
+struct channel {
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<void*> items;
+    bool done = false;
+};
+
+//producers allocate and stamp, consumers on other threads check and free.
+//A first thread reserves more blocks than the rounds can ever hold at once
+//(in flight plus up to two batches per thread), so every later block is a
+//recycled one and the reserve must not grow
+static void test_cross_thread() {
+    const std::size_t pairs = 3, per_round = 1000;
+    std::thread([pairs, per_round]() {
+        std::vector<void*> blocks;
+        for (std::size_t i = 0; i < pairs * (per_round + 4 * shared_node_cache::batch); ++i) blocks.push_back(take(0, i));
+        for (std::size_t i = 0; i < blocks.size(); ++i) shared_node_cache::deallocate(blocks[i], block_bytes);
+    }).join();
+    check_all_returned();
+    const std::size_t reserved = shared_node_cache::statistics().reserved_bytes;
+    for (int round = 0; round < 10; ++round) {
+        std::vector<channel> channels(pairs);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < pairs; ++t) {
+            channel& c = channels[t];
+            threads.push_back(std::thread([&c, t, per_round]() {
+                for (std::size_t i = 0; i < per_round; ++i) {
+                    void* p = take(t + 1, i);
+                    std::lock_guard<std::mutex> lock(c.lock);
+                    c.items.push_back(p);
+                    c.ready.notify_one();
+                }
+                std::lock_guard<std::mutex> lock(c.lock);
+                c.done = true;
+                c.ready.notify_one();
+            }));
+            threads.push_back(std::thread([&c, t]() {
+                for (std::size_t i = 0;; ++i) {
+                    std::unique_lock<std::mutex> lock(c.lock);
+                    c.ready.wait(lock, [&c]() { return c.done || !c.items.empty(); });
+                    if (c.items.empty()) break;
+                    void* p = c.items.front();
+                    c.items.pop_front();
+                    lock.unlock();
+                    check(p, t + 1, i);
+                    shared_node_cache::deallocate(p, block_bytes);
+                }
+            }));
+        }
+        for (std::size_t i = 0; i < threads.size(); ++i) threads[i].join();
+        check_all_returned();
+        assert(shared_node_cache::statistics().reserved_bytes == reserved);
+    }
+}
+
+//frees blocks in its destructor. Declared thread_local and touched before
+//the cache, it is destroyed after the thread's cache, so it runs retired
+struct late_holder {
+    std::vector<void*> blocks;
+    ~late_holder() {
+        //a retired allocation still works, and is freed with the rest
+        blocks.push_back(take(99, blocks.size()));
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            check(blocks[i], 99, i);
+            shared_node_cache::deallocate(blocks[i], block_bytes);
+        }
+    }
+};
+
+static void test_retired_thread() {
+    const std::size_t held = 5 * shared_node_cache::batch + 7;
+    const shared_node_cache::stats before = shared_node_cache::statistics();
+    std::thread([held]() {
+        thread_local late_holder h;
+        for (std::size_t i = 0; i < held; ++i) h.blocks.push_back(take(99, i));
+    }).join();
+    check_all_returned();
+    //the retired frees went in as whole batches, not one batch per block
+    const shared_node_cache::stats after = shared_node_cache::statistics();
+    assert(after.depot_batches <= before.depot_batches + held / shared_node_cache::batch + 4);
+}
+
+int main() {
+    test_cross_thread();
+    test_retired_thread();
+    std::cout << "test_shared_node_cache: all passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,67 @@
+//
+//  test_slot_stable_vector.cpp
+//  HW6
+//
+//  Checks slot_stable_vector with incremental index growth against a
+//  std::vector given the same push_backs, inserts and erases, at a size
+//  where the index is mmap'd and retired buffers are unmapped in batches.
+//  A failing check aborts through assert.
+//
+//  Build: g++ -std=c++11 -g test_slot_stable_vector.cpp && ./a.out
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "slot_stable_vector.hpp"
+
+template<typename Container, typename Model>
+static bool same(const Container& c, const Model& model) {
+    if (c.size() != model.size() || c.empty() != model.empty()) return false;
+    if (static_cast<std::size_t>(c.end() - c.begin()) != model.size()) return false;
+    return std::equal(model.begin(), model.end(), c.begin());
+}
+
+//incremental growth, with inserts and erases landing on both sides of the copied part
+static void test_incremental_growth() {
+    std::mt19937 rng(6);
+    slot_stable_vector<int> c;
+    std::vector<int> model;
+    c.incremental_growth(true);
+    for (int step = 0; step < 400000; ++step) {     //index passes map_bytes, so it is mmap'd
+        const unsigned r = rng() % 128;
+        if (r == 0 && !model.empty()) {
+            const std::size_t pos = rng() % model.size(), n = std::min<std::size_t>(rng() % 8, model.size() - pos);
+            c.erase(c.cbegin() + pos, c.cbegin() + pos + n);
+            model.erase(model.begin() + pos, model.begin() + pos + n);
+        }
+        else if (r == 1) {
+            const std::size_t pos = rng() % (model.size() + 1), n = rng() % 4;
+            c.insert(c.cbegin() + pos, n, step);
+            model.insert(model.begin() + pos, n, step);
+        }
+        else {
+            c.push_back(step);
+            model.push_back(step);
+        }
+        if (step % 9973 == 0) {
+            assert(same(c, model));
+            for (std::size_t i = 0; i < model.size(); i += 101) assert(c.cbegin() + i - c.cbegin() == static_cast<std::ptrdiff_t>(i));
+        }
+    }
+    assert(same(c, model));
+    const int* first = &c[0];
+    c.incremental_growth(false);
+    c.shrink_to_fit();
+    assert(same(c, model) && &c[0] == first);
+}
+
+int main() {
+    test_incremental_growth();
+    std::cout << "test_slot_stable_vector: all passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,149 @@
+//
+//  test_sorted_stable_vector.cpp
+//  HW6
+//
+//  Checks sorted_stable_vector against std::multiset and stable_flat_set
+//  against std::set given the same inserts and erases, with std::less and
+//  std::greater, and that every lookup answers the same with and without
+//  the search shadow. A failing check aborts through assert.
+//
+//  Build: g++ -std=c++11 -g test_sorted_stable_vector.cpp && ./a.out
+//
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "sorted_stable_vector.hpp"
+
+template<typename Container, typename Model>
+static bool same(const Container& c, const Model& model) {
+    if (c.size() != model.size() || c.empty() != model.empty()) return false;
+    if (static_cast<std::size_t>(c.end() - c.begin()) != model.size()) return false;
+    return std::equal(model.begin(), model.end(), c.begin());
+}
+
+//every lookup on s matches the ordered model, for keys just around [0, range)
+template<typename Sorted, typename Model>
+static void check_lookups(const Sorted& s, const Model& model, const int range) {
+    for (int key = -2; key < range + 2; ++key) {
+        const long lo = std::distance(model.begin(), model.lower_bound(key));
+        const long hi = std::distance(model.begin(), model.upper_bound(key));
+        assert(s.lower_bound(key) - s.begin() == lo);
+        assert(s.upper_bound(key) - s.begin() == hi);
+        assert(s.equal_range(key).first - s.begin() == lo && s.equal_range(key).second - s.begin() == hi);
+        assert(s.count(key) == model.count(key));
+        assert(s.contains(key) == (lo != hi));
+        assert(s.find(key) - s.begin() == (lo != hi ? lo : static_cast<long>(s.size())));
+    }
+}
+
+//random inserts and erase(key) against std::multiset; half the checks run
+//on a rebuilt shadow, and every real edit must drop it
+template<typename Compare>
+static void test_multiset(const unsigned seed) {
+    std::mt19937 rng(seed);
+    const int range = 60;
+    sorted_stable_vector<int, Compare> s;
+    std::multiset<int, Compare> model;
+    for (int step = 0; step < 3000; ++step) {
+        const int key = static_cast<int>(rng() % range);
+        if (rng() % 3 || model.empty()) {
+            const int* old = s.empty() ? nullptr : &s.back();
+            const int old_value = old ? *old : 0;
+            auto r = s.insert(key);
+            model.insert(key);
+            assert(r.second && *r.first == key && !s.has_search_shadow());
+            //equal keys stay in insertion order: the new one is the last of its run
+            assert(r.first + 1 == s.upper_bound(key));
+            //elements keep their address across the insert
+            assert(old == nullptr || (*old == old_value && &s[s.index_of(*old)] == old));
+        }
+        else {
+            const bool shadowed = s.has_search_shadow();
+            const std::size_t n = model.erase(key);
+            assert(s.erase(key) == n);
+            assert(s.has_search_shadow() == (shadowed && n == 0));    //erasing nothing keeps the shadow
+        }
+        if (step % 100 == 0) {
+            assert(same(s, model));
+            check_lookups(s, model, range);
+            s.build_search_shadow();
+            assert(s.has_search_shadow() || s.empty());
+            check_lookups(s, model, range);
+        }
+        else if (step % 7 == 0) s.build_search_shadow();
+    }
+    assert(same(s, model));
+}
+
+//stable_flat_set keeps one element per key: a repeated insert returns the
+//element already there and false
+template<typename Compare>
+static void test_flat_set(const unsigned seed) {
+    std::mt19937 rng(seed);
+    const int range = 80;
+    stable_flat_set<int, Compare> s;
+    std::set<int, Compare> model;
+    for (int step = 0; step < 3000; ++step) {
+        const int key = static_cast<int>(rng() % range);
+        if (step % 50 == 0) s.build_search_shadow();
+        if (rng() % 2) {
+            const bool shadowed = s.has_search_shadow();
+            const int* existing = s.contains(key) ? &*s.find(key) : nullptr;
+            auto r = s.insert(key);
+            assert(r.second == model.insert(key).second);
+            assert(*r.first == key);
+            if (!r.second) {
+                assert(&*r.first == existing);
+                assert(s.has_search_shadow() == shadowed);    //a refused insert keeps the shadow
+            }
+        }
+        else assert(s.erase(key) == model.erase(key));
+        assert(same(s, model));
+        if (step % 100 == 0) check_lookups(s, model, range);
+    }
+}
+
+//sorted_stable_vector answers the same with and without the search shadow
+static void test_search_shadow() {
+    std::mt19937 rng(17);
+    std::vector<int> model;
+    for (int i = 0; i < 777; ++i) model.push_back(static_cast<int>(rng() % 1000));
+    std::sort(model.begin(), model.end());
+    sorted_stable_vector<int> s(model.begin(), model.end());
+    for (int pass = 0; pass < 2; ++pass) {
+        if (pass) s.build_search_shadow();
+        assert(s.has_search_shadow() == (pass == 1));
+        for (int key = -5; key < 1005; ++key) {
+            assert(s.lower_bound(key) - s.begin() == std::lower_bound(model.begin(), model.end(), key) - model.begin());
+            assert(s.upper_bound(key) - s.begin() == std::upper_bound(model.begin(), model.end(), key) - model.begin());
+            assert(s.contains(key) == std::binary_search(model.begin(), model.end(), key));
+        }
+    }
+    s.insert(5000);
+    assert(!s.has_search_shadow() && s.contains(5000));
+    //every shadow size from empty up covers both tree shapes
+    for (int n = 0; n < 70; ++n) {
+        std::multiset<int> m;
+        for (int i = 0; i < n; ++i) m.insert(static_cast<int>(rng() % 40));
+        sorted_stable_vector<int> t(m.begin(), m.end());
+        t.build_search_shadow();
+        check_lookups(t, m, 40);
+    }
+}
+
+int main() {
+    test_multiset<std::less<int> >(1);
+    test_multiset<std::greater<int> >(2);
+    test_flat_set<std::less<int> >(3);
+    test_flat_set<std::greater<int> >(4);
+    test_search_shadow();
+    std::cout << "test_sorted_stable_vector: all passed" << std::endl;
+    return 0;
+}
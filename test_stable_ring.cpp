@@ -0,0 +1,161 @@
+//
+//  test_stable_ring.cpp
+//  HW6
+//
+//  Checks stable_ring against a std::deque cut to the same capacity given
+//  the same pushes, pops, erases, copies and assignments, across many laps
+//  of the circular index, and that iterator arithmetic and element
+//  addresses hold up wherever the ring wraps. A failing check aborts
+//  through assert.
+//
+//  Build: g++ -std=c++11 -g test_stable_ring.cpp && ./a.out
+//
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "stable_ring.hpp"
+
+template<typename Container, typename Model>
+static bool same(const Container& c, const Model& model) {
+    if (c.size() != model.size() || c.empty() != model.empty()) return false;
+    if (static_cast<std::size_t>(c.end() - c.begin()) != model.size()) return false;
+    return std::equal(model.begin(), model.end(), c.begin());
+}
+
+//every pair of positions, including end(), agrees on distance, order and
+//the element reached
+static void check_iterators(const stable_ring<int>& r, const std::deque<int>& model) {
+    typedef stable_ring<int>::const_iterator iter;
+    const long n = static_cast<long>(model.size());
+    for (long i = 0; i <= n; ++i) {
+        const iter a = r.begin() + i;
+        assert(a == r.end() - (n - i));
+        if (i < n) {
+            assert(*a == model[i] && &*a == &r[i] && r.begin()[i] == model[i]);
+            assert(++iter(a) == a + 1 && --(a + 1) == a);
+        }
+        for (long j = 0; j <= n; ++j) {
+            const iter b = r.begin() + j;
+            assert(b - a == j - i);
+            assert((a < b) == (i < j) && (a <= b) == (i <= j) && (a > b) == (i > j) && (a >= b) == (i >= j));
+            assert(a + (j - i) == b && b - (j - i) == a);
+        }
+    }
+    //walking back from end() visits the model in reverse
+    std::deque<int>::const_reverse_iterator m = model.rbegin();
+    for (iter it = r.end(); it != r.begin(); ++m) {
+        --it;
+        assert(*it == *m);
+    }
+    assert(m == model.rend());
+}
+
+static void test_model() {
+    std::mt19937 rng(9);
+    for (std::size_t cap = 1; cap <= 9; ++cap) {
+        stable_ring<int> r(cap);
+        std::deque<int> model;
+        for (int step = 0; step < 3000; ++step) {
+            const int value = static_cast<int>(rng() % 1000);
+            switch (rng() % 8) {
+                case 0: case 1: case 2: {
+                    //a full ring overwrites its oldest node with the new value
+                    const bool full = r.full();
+                    const int* oldest = r.empty() ? nullptr : &r.front();
+                    const int* kept = r.size() > 1 ? &r[1] : nullptr;
+                    r.push_back(value);
+                    if (full) {
+                        model.pop_front();
+                        assert(&r.back() == oldest);
+                        assert(kept == nullptr || &r.front() == kept);
+                    }
+                    else if (oldest) assert(&r.front() == oldest);
+                    model.push_back(value);
+                    break;
+                }
+                case 3:
+                    r.pop_front();
+                    if (!model.empty()) model.pop_front();
+                    break;
+                case 4:
+                    r.pop_back();
+                    if (!model.empty()) model.pop_back();
+                    break;
+                case 5: {
+                    if (model.empty()) break;
+                    const bool front = rng() % 2;
+                    const std::size_t rest = model.size() - 1;
+                    stable_ring<int>::iterator it = r.erase(front ? r.cbegin() : r.cend() - 1);
+                    assert(it == (front ? r.begin() : r.end()) && r.size() == rest);
+                    if (front) model.pop_front();
+                    else model.pop_back();
+                    break;
+                }
+                case 6: {
+                    //only the ends can be erased
+                    if (model.size() < 3) break;
+                    bool thrown = false;
+                    try { r.erase(r.cbegin() + 1 + rng() % (model.size() - 2)); }
+                    catch (const std::invalid_argument&) { thrown = true; }
+                    assert(thrown);
+                    break;
+                }
+                default:
+                    if (step % 50 == 7) {
+                        stable_ring<int> copy(r);
+                        assert(same(copy, model) && copy.capacity() == cap && copy == r);
+                        if (!model.empty()) assert(&copy.front() != &r.front());
+                        //assignment takes the source's capacity as well
+                        stable_ring<int> other(cap + 3);
+                        other.push_back(-1);
+                        other = copy;
+                        assert(same(other, model) && other.capacity() == cap);
+                        r.clear();
+                        assert(same(r, std::deque<int>()));
+                        r = other;
+                    }
+                    else if (step % 500 == 8) {
+                        r.clear();
+                        model.clear();
+                    }
+                    break;
+            }
+            assert(same(r, model) && r.full() == (model.size() == cap));
+            if (step % 10 == 0) check_iterators(r, model);
+        }
+    }
+}
+
+//swap exchanges contents and capacities; element addresses follow them
+static void test_swap_and_at() {
+    stable_ring<int> a(3), b(5);
+    for (int i = 0; i < 7; ++i) a.push_back(i);
+    for (int i = 0; i < 2; ++i) b.push_back(10 + i);
+    const int* p = &a[1];
+    a.swap(b);
+    assert(same(a, std::deque<int>{ 10, 11 }) && a.capacity() == 5);
+    assert(same(b, std::deque<int>{ 4, 5, 6 }) && b.capacity() == 3);
+    assert(p == &b[1] && *p == 5);
+    assert(b.at(2) == 6);
+    bool thrown = false;
+    try { b.at(3); }
+    catch (const std::range_error&) { thrown = true; }
+    assert(thrown);
+    thrown = false;
+    try { stable_ring<int> zero(0); }
+    catch (const std::invalid_argument&) { thrown = true; }
+    assert(thrown);
+}
+
+int main() {
+    test_model();
+    test_swap_and_at();
+    std::cout << "test_stable_ring: all passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,392 @@
+//
+//  test_stable_vector.cpp
+//  HW6
+//
+//  Checks for the extensions of stable_vector.hpp. The container is given
+//  the same random operations as a std::vector or std::deque and compared
+//  after every step; references it promises to keep are checked too. The
+//  containers in the other headers have test_<header>.cpp files of their
+//  own. A failing check aborts through assert.
+//
+//  Build: g++ -std=c++11 -g -pthread test_stable_vector.cpp && ./a.out
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "counting_allocator.hpp"
+#include "stable_vector.hpp"
+
+template<typename Container, typename Model>
+static bool same(const Container& c, const Model& model) {
+    if (c.size() != model.size() || c.empty() != model.empty()) return false;
+    if (static_cast<std::size_t>(c.end() - c.begin()) != model.size()) return false;
+    return std::equal(model.begin(), model.end(), c.begin());
+}
+
+//every element must know its own position
+template<typename Container>
+static bool positions_ok(const Container& c) {
+    for (std::size_t i = 0; i < c.size(); ++i)
+        if (c.index_of(c[i]) != i || &*(c.begin() + i) != &c[i]) return false;
+    return true;
+}
+
+static void test_apply_edits() {
+    typedef stable_vector<std::string> sv_type;
+    std::mt19937 rng(1);
+    sv_type c;
+    std::vector<std::string> model;
+    for (int i = 0; i < 100; ++i) {
+        c.push_back(std::to_string(i));
+        model.push_back(std::to_string(i));
+    }
+    for (int round = 0; round < 300; ++round) {
+        std::vector<sv_type::edit> edits;
+        std::vector<bool> erased(model.size(), false);
+        for (std::size_t pos = 0; pos <= model.size(); pos += rng() % 6) {
+            sv_type::edit e;
+            e.pos = pos;
+            if (pos < model.size() && !erased[pos] && rng() % 2) {
+                e.op = sv_type::edit::erase_op;
+                erased[pos] = true;
+            }
+            else {
+                e.op = sv_type::edit::insert_op;
+                e.value = "r" + std::to_string(round);
+            }
+            edits.push_back(e);
+            if (edits.size() > 40) break;
+        }
+        std::vector<const std::string*> kept;
+        for (std::size_t i = 0; i < model.size(); ++i) if (!erased[i]) kept.push_back(&c[i]);
+
+        c.apply_edits(edits);
+        std::vector<std::string> out;
+        std::size_t e = 0;
+        for (std::size_t i = 0; i <= model.size(); ++i) {
+            for (; e < edits.size() && edits[e].pos == i; ++e)
+                if (edits[e].op == sv_type::edit::insert_op) out.push_back(edits[e].value);
+            if (i < model.size() && !erased[i]) out.push_back(model[i]);
+        }
+        model.swap(out);
+        assert(same(c, model) && positions_ok(c));
+        //the surviving nodes are the old ones, in order
+        std::size_t k = 0;
+        for (std::size_t i = 0; i < c.size() && k < kept.size(); ++i) if (&c[i] == kept[k]) ++k;
+        assert(k == kept.size());
+    }
+
+    std::vector<sv_type::edit> bad(2);
+    bad[0].op = bad[1].op = sv_type::edit::erase_op;
+    bad[0].pos = bad[1].pos = 0;
+    bool threw = false;
+    try { c.apply_edits(bad); } catch (const std::invalid_argument&) { threw = true; }
+    assert(threw && same(c, model));
+}
+
+//push/pop at both ends and in the middle, against std::deque
+template<typename Container>
+static void test_both_ends() {
+    std::mt19937 rng(2);
+    Container c;
+    std::deque<int> model;
+    const int* front_ref = nullptr;
+    for (int step = 0; step < 20000; ++step) {
+        const unsigned r = rng() % 10;
+        if (r < 3) {
+            c.push_front(step);
+            model.push_front(step);
+        }
+        else if (r < 5) {
+            c.push_back(step);
+            model.push_back(step);
+        }
+        else if (r < 7) {
+            c.pop_front();
+            if (!model.empty()) model.pop_front();
+        }
+        else if (r < 8) {
+            c.pop_back();
+            if (!model.empty()) model.pop_back();
+        }
+        else if (r < 9) {
+            const std::size_t pos = rng() % (model.size() + 1);
+            c.insert(c.cbegin() + pos, step);
+            model.insert(model.begin() + pos, step);
+        }
+        else if (!model.empty()) {
+            const std::size_t pos = rng() % model.size();
+            c.erase(c.cbegin() + pos);
+            model.erase(model.begin() + pos);
+        }
+        //the last element stays where it is while something is in front of it
+        if (!model.empty() && r < 3 && front_ref) assert(*front_ref == c[1]);
+        front_ref = model.empty() ? nullptr : &c.front();
+        if (step % 97 == 0) assert(same(c, model) && positions_ok(c));
+    }
+    assert(same(c, model));
+    c.emplace_front(-1);
+    model.push_front(-1);
+    assert(same(c, model) && positions_ok(c));
+}
+
+static void test_resize_and_append() {
+    stable_vector<int> c;
+    std::vector<int> model;
+    c.resize(1000, default_init);
+    model.resize(1000);
+    assert(c.size() == 1000);
+    for (std::size_t i = 0; i < 1000; ++i) c[i] = model[i] = static_cast<int>(i);
+    c.resize(1500, 7);
+    model.resize(1500, 7);
+    assert(same(c, model) && positions_ok(c));
+    c.resize(300, default_init);
+    model.resize(300);
+    assert(same(c, model));
+
+    int next = 0;
+    c.append_n(5000, [&next]() { return next++; });
+    for (int i = 0; i < 5000; ++i) model.push_back(i);
+    assert(same(c, model) && positions_ok(c));
+    c.append_n(0, [&next]() { return next++; });
+    assert(next == 5000 && same(c, model));
+}
+
+static void test_assign_reuses_nodes() {
+    stable_vector<std::string> c;
+    for (int i = 0; i < 50; ++i) c.push_back(std::to_string(i));
+    std::vector<const std::string*> before;
+    for (std::size_t i = 0; i < c.size(); ++i) before.push_back(&c[i]);
+
+    c.assign(30, std::string("x"));
+    assert(c.size() == 30 && std::count(c.begin(), c.end(), "x") == 30);
+    for (std::size_t i = 0; i < 30; ++i) assert(&c[i] == before[i]);
+    c.assign(80, std::string("y"));
+    assert(c.size() == 80 && std::count(c.begin(), c.end(), "y") == 80 && positions_ok(c));
+    for (std::size_t i = 0; i < 30; ++i) assert(&c[i] == before[i]);
+
+    std::vector<std::string> src;
+    for (int i = 0; i < 120; ++i) src.push_back("s" + std::to_string(i));
+    c.assign(src.begin(), src.end());
+    assert(same(c, src) && positions_ok(c));
+    for (std::size_t i = 0; i < 30; ++i) assert(&c[i] == before[i]);
+    c.assign(src.begin(), src.begin() + 10);
+    assert(same(c, std::vector<std::string>(src.begin(), src.begin() + 10)));
+    for (std::size_t i = 0; i < 10; ++i) assert(&c[i] == before[i]);
+    std::istringstream in("a b c d e f g h i j k l m n o p q r");
+    c.assign(std::istream_iterator<std::string>(in), std::istream_iterator<std::string>());
+    assert(c.size() == 18 && c[0] == "a" && c[17] == "r" && positions_ok(c));
+}
+
+//single-pass input: built in chunks whose sizes straddle the chunk boundaries
+static void test_input_iterator_construction() {
+    const int sizes[] = { 0, 1, 15, 16, 17, 48, 49, 5000, 20000 };
+    for (std::size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+        std::ostringstream out;
+        std::vector<long> model;
+        for (int i = 0; i < sizes[k]; ++i) {
+            out << i * 3 << ' ';
+            model.push_back(i * 3);
+        }
+        std::istringstream in(out.str());
+        stable_vector<long> c((std::istream_iterator<long>(in)), std::istream_iterator<long>());
+        assert(same(c, model) && positions_ok(c));
+    }
+}
+
+//copying throws once the countdown reaches zero; no default constructor
+struct fragile {
+    static int countdown, live;
+    int v;
+    explicit fragile(const int x) : v(x) { ++live; }
+    fragile(const fragile& o) : v(o.v) {
+        if (countdown >= 0 && countdown-- == 0) throw std::runtime_error("fragile");
+        ++live;
+    }
+    fragile& operator=(const fragile& o) { v = o.v; return *this; }
+    ~fragile() { --live; }
+    bool operator==(const fragile& o) const { return v == o.v; }
+};
+int fragile::countdown = -1;
+int fragile::live = 0;
+
+static void test_construction_rollback() {
+    std::vector<fragile> src;
+    for (int i = 0; i < 100; ++i) src.push_back(fragile(i));
+    const int live = fragile::live;
+    for (int fail = 0; fail < 100; fail += 7) {
+        fragile::countdown = fail;
+        bool threw = false;
+        try { stable_vector<fragile> c(src.begin(), src.end()); } catch (const std::runtime_error&) { threw = true; }
+        fragile::countdown = -1;
+        assert(threw && fragile::live == live);
+    }
+    stable_vector<fragile> c(src.begin(), src.end());
+    fragile::countdown = 50;
+    bool threw = false;
+    try { stable_vector<fragile> d(c); } catch (const std::runtime_error&) { threw = true; }
+    fragile::countdown = -1;
+    assert(threw && fragile::live == live + 100 && same(c, src));
+}
+
+//the threaded build path, forced on: 300000 elements pass parallel_threshold
+static void test_parallel_construction() {
+    stable_vector_parallel::threads() = 4;
+    std::vector<int> model;
+    for (int i = 0; i < 300000; ++i) model.push_back(i);
+    stable_vector<int> c(model.begin(), model.end());
+    assert(same(c, model) && positions_ok(c));
+    stable_vector<int> d(c);
+    assert(same(d, model) && positions_ok(d));
+    stable_vector<int> e(300000, 7);
+    assert(e.size() == 300000 && std::count(e.begin(), e.end(), 7) == 300000 && positions_ok(e));
+    stable_vector_parallel::threads() = 0;
+}
+
+static void test_bounds() {
+    std::mt19937 rng(3);
+    std::vector<int> model;
+    for (int i = 0; i < 3000; ++i) model.push_back(static_cast<int>(rng() % 1000));
+    std::sort(model.begin(), model.end());
+    const stable_vector<int> c(model.begin(), model.end());
+    for (int key = -5; key < 1005; ++key) {
+        assert(c.lower_bound(key) - c.begin() == std::lower_bound(model.begin(), model.end(), key) - model.begin());
+        assert(c.upper_bound(key) - c.begin() == std::upper_bound(model.begin(), model.end(), key) - model.begin());
+        assert(c.binary_search(key) == std::binary_search(model.begin(), model.end(), key));
+    }
+    std::vector<int> desc(model.rbegin(), model.rend());
+    stable_vector<int> d(desc.begin(), desc.end());
+    for (int key = -5; key < 1005; key += 3) {
+        const std::greater<int> g;
+        assert(d.lower_bound(key, g) - d.begin() == std::lower_bound(desc.begin(), desc.end(), key, g) - desc.begin());
+        assert(d.upper_bound(key, g) - d.begin() == std::upper_bound(desc.begin(), desc.end(), key, g) - desc.begin());
+        assert(d.binary_search(key, g) == std::binary_search(desc.begin(), desc.end(), key, g));
+    }
+    const stable_vector<int> empty;
+    assert(empty.lower_bound(1) == empty.end() && !empty.binary_search(1));
+}
+
+//fix-ups split across the workers, forced on for small sizes; the workers are
+//reused, and a second caller runs its fix-ups serially meanwhile
+static void test_parallel_fixup() {
+    stable_vector_parallel::threads() = 4;
+    stable_vector_parallel::fixup_threshold() = 0;
+    std::vector<int> model;
+    for (int i = 0; i < 200000; ++i) model.push_back(i);
+    stable_vector<int> d(model.begin(), model.end()), e(d);
+    d.insert(d.begin() + 1, -1);
+    model.insert(model.begin() + 1, -1);
+    d.erase(d.begin() + 5);
+    model.erase(model.begin() + 5);
+    assert(same(d, model) && positions_ok(d));
+
+    std::thread other([&e]() {
+        for (int r = 0; r < 20; ++r) {
+            e.insert(e.begin() + 1, r);
+            e.erase(e.begin() + 1);
+        }
+    });
+    for (int r = 0; r < 20; ++r) {
+        d.insert(d.begin() + 1, r);
+        d.erase(d.begin() + 1);
+    }
+    other.join();
+    assert(same(d, model) && positions_ok(d) && positions_ok(e));
+    stable_vector_parallel::threads() = 0;
+    stable_vector_parallel::fixup_threshold() = 1 << 20;
+}
+
+static void test_inline_slots() {
+    allocation_stats stats;
+    typedef counting_allocator<long> alloc;
+    {
+        stable_vector<long, alloc> c((alloc(&stats)));
+        assert(c.empty() && c.begin() == c.end());
+    }
+    assert(stats.all().allocations == 0);
+
+    typedef stable_vector<long, alloc, 8> small;
+    small a((alloc(&stats))), b((alloc(&stats)));
+    std::vector<long> ma, mb;
+    for (long i = 0; i < 8; ++i) {
+        a.push_back(i);
+        ma.push_back(i);
+    }
+    //8 elements: nodes come from one slab, the index stays in the object
+    assert(stats.all().allocations <= 2 && same(a, ma) && positions_ok(a));
+    for (long i = 0; i < 30; ++i) {
+        b.push_front(i);
+        mb.insert(mb.begin(), i);
+    }
+    const long* kept = &a[3];
+    a.swap(b);
+    assert(same(a, mb) && same(b, ma) && &b[3] == kept && positions_ok(a) && positions_ok(b));
+    a.swap(b);
+    assert(same(a, ma) && same(b, mb) && &a[3] == kept);
+    small c(a);
+    assert(c == a && positions_ok(c));
+    c = b;
+    assert(c == b && positions_ok(c));
+    c.clear();
+    assert(c.empty() && c.begin() == c.end());
+
+    //T without a default constructor: nothing is built for end()
+    stable_vector<fragile, std::allocator<fragile>, 4> f;
+    f.push_back(fragile(1));
+    f.emplace_front(0);
+    assert(f.size() == 2 && f[0].v == 0 && f[1].v == 1);
+}
+
+struct alignas(128) wide {
+    long x;
+    wide(const long v = 0) : x(v) {}
+    bool operator==(const wide& o) const { return x == o.x; }
+};
+
+static void test_alignment() {
+    stable_vector<long, std::allocator<long>, 0, cache_line_align> c;
+    std::vector<long> model;
+    for (long i = 0; i < 500; ++i) {
+        c.push_back(i);
+        model.push_back(i);
+    }
+    for (std::size_t i = 1; i < c.size(); ++i)
+        assert(reinterpret_cast<std::uintptr_t>(&c[i]) / 64 != reinterpret_cast<std::uintptr_t>(&c[i - 1]) / 64);
+    c.erase(c.begin() + 10, c.begin() + 100);
+    model.erase(model.begin() + 10, model.begin() + 100);
+    assert(same(c, model) && positions_ok(c));
+
+    stable_vector<wide> w(300, wide(5));
+    w.insert(w.begin() + 7, wide(9));
+    for (std::size_t i = 0; i < w.size(); ++i) assert(reinterpret_cast<std::uintptr_t>(&w[i]) % 128 == 0);
+    assert(w[7].x == 9 && positions_ok(w));
+}
+
+int main() {
+    test_apply_edits();
+    test_both_ends<stable_vector<int> >();
+    test_both_ends<stable_vector<int, std::allocator<int>, 8> >();
+    test_resize_and_append();
+    test_assign_reuses_nodes();
+    test_input_iterator_construction();
+    test_construction_rollback();
+    test_parallel_construction();
+    test_bounds();
+    test_parallel_fixup();
+    test_inline_slots();
+    test_alignment();
+    std::cout << "test_stable_vector: all passed" << std::endl;
+    return 0;
+}
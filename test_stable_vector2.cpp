@@ -0,0 +1,230 @@
+//
+//  test_stable_vector2.cpp
+//  HW6
+//
+//  Checks for the extensions made to stable_vector2.hpp, each against a
+//  std::vector that is given the same operations. Needs Boost (1.55 or a
+//  current release); a failing check aborts through assert.
+//
+//  Build: g++ -std=c++11 -g test_stable_vector2.cpp && ./a.out
+//
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "stable_vector2.hpp"
+
+typedef boost::container::stable_vector<std::string> sv_type;
+
+template<typename Container>
+static bool same(const Container& c, const std::vector<std::string>& model) {
+    return c.size() == model.size() && std::equal(c.begin(), c.end(), model.begin());
+}
+
+//model: inserts at pos go before the element at pos, in script order
+static void apply_to_model(std::vector<std::string>& model, const std::vector<sv_type::edit>& edits) {
+    std::vector<std::string> out;
+    std::size_t e = 0;
+    for (std::size_t i = 0; i <= model.size(); ++i) {
+        bool erased = false;
+        for (; e < edits.size() && edits[e].pos == i; ++e) {
+            if (edits[e].op == sv_type::edit::insert_op) out.push_back(edits[e].value);
+            else erased = true;
+        }
+        if (i < model.size() && !erased) out.push_back(model[i]);
+    }
+    model.swap(out);
+}
+
+static void test_apply_edits() {
+    std::mt19937 rng(7);
+    sv_type c;
+    std::vector<std::string> model;
+    for (int i = 0; i < 200; ++i) {
+        c.push_back(std::to_string(i));
+        model.push_back(std::to_string(i));
+    }
+    for (int round = 0; round < 300; ++round) {
+        std::vector<sv_type::edit> edits;
+        std::size_t last_erased = std::size_t(-1);
+        for (std::size_t pos = 0; pos <= model.size(); pos += 1 + rng() % 8) {
+            sv_type::edit e;
+            e.pos = pos;
+            if (pos < model.size() && pos != last_erased && rng() % 2) {
+                e.op = sv_type::edit::erase_op;
+                last_erased = pos;
+            }
+            else {
+                e.op = sv_type::edit::insert_op;
+                e.value = "n" + std::to_string(round) + "." + std::to_string(pos);
+            }
+            edits.push_back(e);
+        }
+        //references to elements that survive must stay valid
+        std::vector<const std::string*> kept;
+        std::vector<std::string> kept_values;
+        std::size_t e = 0;
+        for (std::size_t i = 0; i < model.size(); ++i) {
+            while (e < edits.size() && edits[e].pos < i) ++e;
+            bool erased = false;
+            for (std::size_t k = e; k < edits.size() && edits[k].pos == i; ++k)
+                if (edits[k].op == sv_type::edit::erase_op) erased = true;
+            if (!erased) {
+                kept.push_back(&c[i]);
+                kept_values.push_back(c[i]);
+            }
+        }
+        c.apply_edits(edits);
+        apply_to_model(model, edits);
+        assert(same(c, model));
+        for (std::size_t k = 0, i = 0; k < kept.size(); ++i)
+            if (&c[i] == kept[k]) assert(c[i] == kept_values[k++]);
+    }
+
+    //unsorted and invalid scripts are rejected and leave the container alone
+    std::vector<std::string> before(c.begin(), c.end());
+    std::vector<sv_type::edit> bad(2);
+    bad[0].op = bad[1].op = sv_type::edit::insert_op;
+    bad[0].pos = 5;
+    bad[1].pos = 4;
+    bool threw = false;
+    try { c.apply_edits(bad); } catch (const std::logic_error&) { threw = true; }
+    assert(threw && same(c, before));
+    bad[0].op = bad[1].op = sv_type::edit::erase_op;
+    bad[0].pos = bad[1].pos = 4;
+    threw = false;
+    try { c.apply_edits(bad); } catch (const std::logic_error&) { threw = true; }
+    assert(threw && same(c, before));
+}
+
+//copying throws once the countdown reaches zero
+struct fragile {
+    static int countdown;
+    int v;
+    explicit fragile(const int x = 0) : v(x) {}
+    fragile(const fragile& o) : v(o.v) { if (countdown >= 0 && countdown-- == 0) throw std::runtime_error("fragile"); }
+    fragile& operator=(const fragile& o) { v = o.v; return *this; }
+};
+int fragile::countdown = -1;
+
+static void test_apply_edits_rollback() {
+    typedef boost::container::stable_vector<fragile> fv_type;
+    fv_type c;
+    for (int i = 0; i < 50; ++i) c.push_back(fragile(i));
+    const fragile* first = &c[0];
+    std::vector<fv_type::edit> edits;
+    for (int i = 0; i < 10; ++i) {
+        fv_type::edit e;
+        e.op = i % 2 ? fv_type::edit::erase_op : fv_type::edit::insert_op;
+        e.pos = 5 * i;
+        e.value = fragile(-i);
+        edits.push_back(e);
+    }
+    fragile::countdown = 3;
+    bool threw = false;
+    try { c.apply_edits(edits); } catch (const std::runtime_error&) { threw = true; }
+    fragile::countdown = -1;
+    assert(threw && c.size() == 50 && &c[0] == first);
+    for (int i = 0; i < 50; ++i) assert(c[i].v == i);
+    c.apply_edits(edits);
+    assert(c.size() == 50 && c[0].v == 0 && c[1].v == 0 && c[2].v == 1);
+}
+
+static void test_pool_trimming() {
+    std::mt19937 rng(11);
+    sv_type c;
+    std::vector<std::string> model;
+    for (int i = 0; i < 3000; ++i) {
+        c.push_back(std::to_string(i));
+        model.push_back(std::to_string(i));
+    }
+    assert(c.pool_high_watermark() == sv_type::size_type(-1));
+    sv_type untrimmed(c.begin(), c.end());
+    untrimmed.erase(untrimmed.begin(), untrimmed.begin() + 2000);
+    assert(untrimmed.get_pool_stats().pool_size == 2000 && untrimmed.get_pool_stats().trim_steps == 0);
+
+    const sv_type::size_type high = 100, low = 20;
+    c.set_pool_limits(high, low);
+    assert(c.pool_high_watermark() == high && c.pool_low_watermark() == low);
+    for (int round = 0; round < 2000; ++round) {
+        const std::size_t pos = rng() % (model.size() + 1);
+        switch (rng() % 4) {
+            case 0: {   //single erase
+                if (model.empty()) break;
+                const std::size_t p = pos % model.size();
+                c.erase(c.begin() + p);
+                model.erase(model.begin() + p);
+                break;
+            }
+            case 1: {   //range erase
+                const std::size_t n = std::min<std::size_t>(rng() % 300, model.size() - pos);
+                c.erase(c.begin() + pos, c.begin() + pos + n);
+                model.erase(model.begin() + pos, model.begin() + pos + n);
+                break;
+            }
+            default:    //insert, reusing pooled nodes
+                c.insert(c.begin() + pos, std::to_string(round));
+                model.insert(model.begin() + pos, std::to_string(round));
+        }
+        const sv_type::pool_stats st = c.get_pool_stats();
+        assert(st.pool_size <= high + 1 && st.pool_size <= st.peak_pool_size);
+        assert(same(c, model));
+    }
+    const sv_type::pool_stats st = c.get_pool_stats();
+    assert(st.trim_steps > 0 && st.nodes_trimmed > 0);
+
+    //apply_edits trims too
+    std::vector<sv_type::edit> edits;
+    for (std::size_t pos = 0; pos < model.size(); pos += 2) {
+        sv_type::edit e;
+        e.op = sv_type::edit::erase_op;
+        e.pos = pos;
+        edits.push_back(e);
+    }
+    c.apply_edits(edits);
+    apply_to_model(model, edits);
+    assert(same(c, model) && c.get_pool_stats().pool_size <= high + 1);
+
+    //the limits and counters go with the contents on swap
+    const sv_type::pool_stats before = c.get_pool_stats();
+    c.swap(untrimmed);
+    assert(untrimmed.pool_high_watermark() == high && c.pool_high_watermark() == sv_type::size_type(-1));
+    assert(untrimmed.get_pool_stats().nodes_trimmed == before.nodes_trimmed && c.get_pool_stats().trim_steps == 0);
+    assert(same(untrimmed, model));
+}
+
+//counts destroy calls (for every rebound copy); T's destructor may be trivial
+static int destroy_calls = 0;
+
+template<class T>
+struct destroy_counting_allocator : std::allocator<T> {
+    template<class U> struct rebind { typedef destroy_counting_allocator<U> other; };
+    destroy_counting_allocator() {}
+    template<class U> destroy_counting_allocator(const destroy_counting_allocator<U>&) {}
+    template<class U> void destroy(U* p) { ++destroy_calls; p->~U(); }
+};
+
+static void test_allocator_destroy() {
+    boost::container::stable_vector<int, destroy_counting_allocator<int> > c;
+    for (int i = 0; i < 10; ++i) c.push_back(i);
+    destroy_calls = 0;
+    c.erase(c.begin() + 2, c.begin() + 7);
+    assert(destroy_calls == 5);
+    c.pop_back();
+    c.clear();
+    assert(destroy_calls == 10);
+}
+
+int main() {
+    test_apply_edits();
+    test_apply_edits_rollback();
+    test_pool_trimming();
+    test_allocator_destroy();
+    std::cout << "test_stable_vector2: all passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,83 @@
+//
+//  test_tombstone_stable_vector.cpp
+//  HW6
+//
+//  Checks tombstone_stable_vector against a std::vector given the same
+//  operations: lazy erase keeps the following elements in place, compaction
+//  keeps every reference, and the dead ratio stays under its limit. A
+//  failing check aborts through assert.
+//
+//  Build: g++ -std=c++11 -g test_tombstone_stable_vector.cpp && ./a.out
+//
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "tombstone_stable_vector.hpp"
+
+template<typename Container, typename Model>
+static bool same(const Container& c, const Model& model) {
+    if (c.size() != model.size() || c.empty() != model.empty()) return false;
+    if (static_cast<std::size_t>(c.end() - c.begin()) != model.size()) return false;
+    return std::equal(model.begin(), model.end(), c.begin());
+}
+
+static void test_tombstones() {
+    std::mt19937 rng(4);
+    tombstone_stable_vector<int> c;
+    std::vector<int> model;
+    c.lazy_erase(true);
+    c.max_dead_ratio(0.5);
+    for (int i = 0; i < 2000; ++i) {
+        c.push_back(i);
+        model.push_back(i);
+    }
+    for (int step = 0; step < 6000; ++step) {
+        const unsigned r = rng() % 10;
+        if (r < 4 && !model.empty()) {
+            const std::size_t pos = rng() % model.size();
+            const int* next = pos + 1 < model.size() ? &c[pos + 1] : nullptr;
+            c.erase(c.cbegin() + pos);
+            model.erase(model.begin() + pos);
+            if (next) assert(&c[pos] == next);
+        }
+        else if (r < 5 && !model.empty()) {
+            const std::size_t pos = rng() % model.size(), n = std::min<std::size_t>(rng() % 20, model.size() - pos);
+            c.erase(c.cbegin() + pos, c.cbegin() + pos + n);
+            model.erase(model.begin() + pos, model.begin() + pos + n);
+        }
+        else if (r < 8) {
+            const std::size_t pos = rng() % (model.size() + 1);
+            c.insert(c.cbegin() + pos, step);
+            model.insert(model.begin() + pos, step);
+        }
+        else if (r < 9) {
+            c.push_back(step);
+            model.push_back(step);
+        }
+        else {
+            std::vector<const int*> refs;
+            for (std::size_t i = 0; i < c.size(); ++i) refs.push_back(&c[i]);
+            c.compact();
+            assert(c.dead_count() == 0);
+            for (std::size_t i = 0; i < c.size(); ++i) assert(&c[i] == refs[i]);
+        }
+        assert(c.dead_count() <= 0.5 * (c.size() + c.dead_count()) + 1);
+        if (step % 53 == 0) assert(same(c, model));
+    }
+    assert(same(c, model));
+    c.lazy_erase(false);
+    assert(c.dead_count() == 0 && same(c, model));
+    c.erase(c.cbegin());
+    model.erase(model.begin());
+    assert(c.dead_count() == 0 && same(c, model));
+}
+
+int main() {
+    test_tombstones();
+    std::cout << "test_tombstone_stable_vector: all passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,348 @@
+#ifndef TOMBSTONE_STABLE_VECTOR_HPP
+#define TOMBSTONE_STABLE_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// stable_vector variant (nodes store their slot number, as in
+// slot_stable_vector) with an opt-in lazy erase. With lazy_erase(true),
+// erase destroys the element and leaves a tombstone (a null slot) instead of
+// closing the gap, so nothing after it is renumbered. Iterators step over
+// tombstones. compact() squeezes them out in one sweep; it also runs by
+// itself once the tombstones exceed max_dead_ratio() of the slots.
+//
+// While there are tombstones, a Fenwick tree over the live flags maps
+// positions to slots, so operator[], iterator arithmetic and erase cost
+// O(log n). Without tombstones it is not kept and positions are slots.
+template<typename T>
+class tombstone_stable_vector {
+    private:
+        struct node_base;
+        struct node;
+        struct index_block;
+
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        template<typename Value> class tombstone_iterator;
+        typedef tombstone_iterator<T> iterator;
+        typedef tombstone_iterator<const T> const_iterator;
+
+        tombstone_stable_vector():b(new index_block) {}
+
+        explicit tombstone_stable_vector(const size_type n, const T& value = T()):b(new index_block) {
+            insert(cend(), n, value);
+        }
+
+        template<typename InputIterator>
+        tombstone_stable_vector(InputIterator first, InputIterator last, typename std::enable_if<!std::is_integral<InputIterator>::value>::type* = nullptr):b(new index_block) {
+            for (; first!=last; ++first) push_back(*first);
+        }
+
+        tombstone_stable_vector(const tombstone_stable_vector& rhs):b(new index_block) {
+            b->v.reserve(rhs.size()+1);
+            b->lazy=rhs.b->lazy;
+            b->max_dead=rhs.b->max_dead;
+            for (const_iterator it=rhs.begin(); it!=rhs.end(); ++it) push_back(*it);
+        }
+
+        tombstone_stable_vector& operator=(const tombstone_stable_vector& rhs) {
+            tombstone_stable_vector(rhs).swap(*this);
+            return *this;
+        }
+
+        ~tombstone_stable_vector() { clear(); }
+
+        reference at(const size_type pos) { return pos < size() ? (*this)[pos] : throw std::range_error("tombstone_stable_vector: out of range"); }
+        const_reference at(const size_type pos) const { return pos < size() ? (*this)[pos] : throw std::range_error("tombstone_stable_vector: out of range"); }
+
+        reference operator[](const size_type pos) { return value(b->at(pos)); }
+        const_reference operator[](const size_type pos) const { return value(b->at(pos)); }
+
+        reference front() { return value(b->at(0)); }
+        const_reference front() const { return value(b->at(0)); }
+
+        reference back() { return value(b->at(size()-1)); }
+        const_reference back() const { return value(b->at(size()-1)); }
+
+        iterator begin() { return iterator(b.get(), b->at(0)); }
+        const_iterator begin() const { return const_iterator(b.get(), b->at(0)); }
+        const_iterator cbegin() const { return begin(); }
+
+        iterator end() { return iterator(b.get(), &b->end_node); }
+        const_iterator end() const { return const_iterator(b.get(), &b->end_node); }
+        const_iterator cend() const { return end(); }
+
+        bool empty() const { return size()==0; }
+        size_type size() const { return b->slots()-b->dead; }
+
+        bool lazy_erase() const { return b->lazy; }
+        void lazy_erase(const bool on) {
+            if (!on) compact();
+            b->lazy=on;
+        }
+
+        // Fraction of slots that may be tombstones before erase compacts.
+        double max_dead_ratio() const { return b->max_dead; }
+        void max_dead_ratio(const double r) { b->max_dead=r; }
+        size_type dead_count() const { return b->dead; }
+
+        // One O(n) sweep: moves the live nodes down over the tombstones and
+        // renumbers them. Iterators to live elements stay valid.
+        void compact() {
+            if (b->dead==0) return;
+            std::vector<node_base*>& v=b->v;
+            size_type w=0;
+            for (size_type r=0; r!=v.size(); ++r) {
+                if (!v[r]) continue;
+                v[w]=v[r];
+                v[w]->slot=w;
+                ++w;
+            }
+            v.resize(w);
+            b->dead=0;
+            b->tree.clear();
+        }
+
+        void clear() { erase(cbegin(), cend()); }
+
+        void push_back(const T& value) {
+            node* n=new node(value, b->slots());
+            try {
+                if (b->dead) b->tree.reserve(b->tree.size()+1);
+                b->v.insert(b->v.end()-1, n);
+            }
+            catch(...) { delete n; throw; }
+            ++b->end_node.slot;
+            if (b->dead) b->append_live();
+        }
+        void pop_back() { if (!empty()) erase(cend()-1); }
+
+        // A single insert right after a tombstone reuses it. Any other
+        // insert opens slots and renumbers the nodes after them.
+        iterator insert(const_iterator pos, const T& value) { return insert(pos, 1, value); }
+        iterator insert(const_iterator pos, const size_type n, const T& value) {
+            size_type p=pos.n->slot, i=0;
+            if (n==1 && p>0 && !b->v[p-1]) {
+                b->v[p-1]=new node(value, p-1);
+                b->mark(p-1, 1);
+                return iterator(b.get(), b->v[p-1]);
+            }
+            b->v.insert(b->v.begin()+p, n, nullptr);
+            try {
+                for (; i<n; ++i) b->v[p+i]=new node(value, p+i);
+            }
+            catch(...) {
+                b->v.erase(b->v.begin()+p+i, b->v.begin()+p+n);
+                renumber(p+i);
+                throw;
+            }
+            renumber(p+n);
+            return iterator(b.get(), b->v[p]);
+        }
+
+        iterator erase(const_iterator pos) { return erase(pos, std::next(pos)); }
+        iterator erase(const_iterator first, const_iterator last) {
+            size_type p1=first.n->slot, p2=last.n->slot;
+            if (!b->lazy) {
+                for (size_type f=p1; f!=p2; ++f) delete static_cast<node*>(b->v[f]);
+                b->v.erase(b->v.begin()+p1, b->v.begin()+p2);
+                renumber(p1);
+                return iterator(b.get(), b->v[p1]);
+            }
+            if (p1==p2) return iterator(b.get(), b->v[p1]);
+            size_type k=b->live_before(p1);
+            if (b->dead==0) b->build_tree();
+            for (size_type f=p1; f!=p2; ++f) {
+                if (!b->v[f]) continue;
+                delete static_cast<node*>(b->v[f]);
+                b->v[f]=nullptr;
+                b->mark(f, -1);
+            }
+            if (b->dead==b->slots() || b->dead>b->max_dead*b->slots()) compact();
+            return iterator(b.get(), b->at(k));
+        }
+
+        void resize(const size_type count, const T& value = T()) {
+            if (count > size()) insert(cend(), count-size(), value);
+            else if (count < size()) erase(cbegin()+count, cend());
+        }
+
+        void swap(tombstone_stable_vector& other) { b.swap(other.b); }
+
+        friend bool operator==(const tombstone_stable_vector& lhs, const tombstone_stable_vector& rhs) {
+            return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+        }
+        friend bool operator!=(const tombstone_stable_vector& lhs, const tombstone_stable_vector& rhs) { return !(lhs == rhs); }
+        friend bool operator< (const tombstone_stable_vector& lhs, const tombstone_stable_vector& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+        }
+        friend bool operator<=(const tombstone_stable_vector& lhs, const tombstone_stable_vector& rhs) { return !(rhs < lhs); }
+        friend bool operator> (const tombstone_stable_vector& lhs, const tombstone_stable_vector& rhs) { return rhs < lhs; }
+        friend bool operator>=(const tombstone_stable_vector& lhs, const tombstone_stable_vector& rhs) { return !(lhs < rhs); }
+
+        template<typename Value>
+        class tombstone_iterator {
+            friend class tombstone_stable_vector;
+
+            public:
+                typedef tombstone_stable_vector::difference_type difference_type;
+                typedef typename std::remove_const<Value>::type value_type;
+                typedef Value* pointer;
+                typedef Value& reference;
+                typedef std::random_access_iterator_tag iterator_category;
+
+                tombstone_iterator():b(nullptr), n(nullptr) {}
+                tombstone_iterator(const index_block* const b_, node_base* const n_):b(b_), n(n_) {}
+                tombstone_iterator(const tombstone_iterator<T>& rhs):b(rhs.b), n(rhs.n) {}
+
+                reference operator*() const { return value(n); }
+                pointer operator->() const { return std::addressof(operator*()); }
+                reference operator[](const difference_type i) const { return value(b->at(b->live_before(n->slot)+i)); }
+
+                tombstone_iterator& operator+=(const difference_type i) { n=b->at(b->live_before(n->slot)+i); return *this; }
+                tombstone_iterator& operator-=(const difference_type i) { return *this+=-i; }
+
+                friend tombstone_iterator operator+(tombstone_iterator it, const difference_type i) { return it+=i; }
+                friend tombstone_iterator operator+(const difference_type i, tombstone_iterator it) { return it+=i; }
+                friend tombstone_iterator operator-(tombstone_iterator it, const difference_type i) { return it-=i; }
+                friend difference_type operator-(const tombstone_iterator lhs, const tombstone_iterator rhs) { return lhs.distance(rhs); }
+
+                //end_node 不是 nullptr, 往後跳一定會停
+                tombstone_iterator& operator++() {
+                    size_type s=n->slot+1;
+                    while (!b->v[s]) ++s;
+                    n=b->v[s];
+                    return *this;
+                }
+                tombstone_iterator operator++(int) {
+                    tombstone_iterator it(*this);
+                    ++*this;
+                    return it;
+                }
+
+                tombstone_iterator& operator--() {
+                    size_type s=n->slot-1;
+                    while (!b->v[s]) --s;
+                    n=b->v[s];
+                    return *this;
+                }
+                tombstone_iterator operator--(int) {
+                    tombstone_iterator it(*this);
+                    --*this;
+                    return it;
+                }
+
+                friend bool operator==(const tombstone_iterator lhs, const tombstone_iterator rhs) { return lhs.n==rhs.n; }
+                friend bool operator!=(const tombstone_iterator lhs, const tombstone_iterator rhs) { return !(lhs==rhs); }
+                friend bool operator< (const tombstone_iterator lhs, const tombstone_iterator rhs) { return lhs.n->slot<rhs.n->slot; }
+                friend bool operator<=(const tombstone_iterator lhs, const tombstone_iterator rhs) { return !(rhs<lhs); }
+                friend bool operator> (const tombstone_iterator lhs, const tombstone_iterator rhs) { return rhs<lhs; }
+                friend bool operator>=(const tombstone_iterator lhs, const tombstone_iterator rhs) { return !(lhs<rhs); }
+
+            private:
+                const index_block* b;
+                node_base* n;
+
+                difference_type distance(const tombstone_iterator rhs) const {
+                    return static_cast<difference_type>(b->live_before(n->slot))-static_cast<difference_type>(b->live_before(rhs.n->slot));
+                }
+
+                template<typename> friend class tombstone_iterator;
+        };
+
+    private:
+        struct node_base {
+            explicit node_base(const size_type s = 0):slot(s) {}
+            size_type slot;
+        };
+
+        struct node : node_base {
+            node(const T& value, const size_type s):node_base(s), datum(value) {}
+            T datum;
+        };
+
+        // Heap block so that swap() keeps iterators (including end()) attached
+        // to their elements.
+        struct index_block {
+            index_block():v(1, &end_node), dead(0), max_dead(0.25), lazy(false) {}
+            std::vector<node_base*> v;      //v.back() 是 end_node; nullptr 是 tombstone
+            std::vector<size_type> tree;    //Fenwick tree, 1-based, 只在 dead>0 時存在
+            size_type dead;
+            double max_dead;
+            node_base end_node;
+            bool lazy;
+
+            size_type slots() const { return v.size()-1; }
+
+            //slot 之前活著的元素個數
+            size_type live_before(size_type slot) const {
+                if (dead==0) return slot;
+                size_type s=0;
+                for (; slot>0; slot-=slot&(~slot+1)) s+=tree[slot];
+                return s;
+            }
+
+            //第 k 個活著的元素所在的 slot; k==size() 時是 end_node
+            size_type slot_of(size_type k) const {
+                if (dead==0) return k;
+                size_type pos=0, step=1, m=slots();
+                while (2*step<=m) step*=2;
+                for (; step; step/=2) {
+                    if (pos+step<=m && tree[pos+step]<=k) {
+                        pos+=step;
+                        k-=tree[pos];
+                    }
+                }
+                return pos;
+            }
+            node_base* at(const size_type k) const { return v[slot_of(k)]; }
+
+            //每個 slot 的值是 0/1, 所以 tree[i] 是 (i-lowbit(i), i] 的活元素數
+            void build_tree() {
+                size_type m=slots();
+                tree.assign(m+1, 0);
+                for (size_type i=1; i<=m; ++i) {
+                    tree[i]+=v[i-1] ? 1 : 0;
+                    size_type parent=i+(i&(~i+1));
+                    if (parent<=m) tree[parent]+=tree[i];
+                }
+            }
+
+            void mark(const size_type slot, const int d) {
+                if (d<0) ++dead;
+                else --dead;
+                if (dead==0 && d>0) { tree.clear(); return; }
+                for (size_type i=slot+1; i<tree.size(); i+=i&(~i+1)) tree[i]+=d;
+            }
+
+            //新的最後一個 slot (活的)
+            void append_live() {
+                size_type i=slots();
+                tree.push_back(1+live_before(i-1)-live_before(i-(i&(~i+1))));
+            }
+        };
+
+        std::unique_ptr<index_block> b;
+
+        static T& value(node_base* const n) { return static_cast<node*>(n)->datum; }
+
+        void renumber(size_type first) {
+            for (; first!=b->v.size(); ++first) if (b->v[first]) b->v[first]->slot=first;
+            if (b->dead) b->build_tree();
+        }
+};
+
+#endif